@@ -0,0 +1,125 @@
+#!/bin/sh
+# Runs mapthin on the small map files in golden/inputs and compares every file written, and the screen output, with
+# the expected files. Each directory in golden holds a case, with the mapthin runs in the file run and the expected
+# files in expected. A run may also check the files itself, and fails the case if it returns non-zero.
+#
+# Usage, from the bench directory:
+#	./goldencheck.sh ./mapthin [case ...]
+# or to replace the expected files with the files written, after checking the differences are wanted:
+#	./goldencheck.sh -update ./mapthin [case ...]
+
+update=0
+if [ "$1" = "-update" ]; then update=1; shift; fi
+
+if [ $# -lt 1 ]; then
+	echo "Usage: ./goldencheck.sh [-update] ./mapthin [case ...]" >&2
+	exit 1
+fi
+
+MAPTHIN=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+shift
+GOLDEN=$(cd "$(dirname "$0")" && pwd)/golden
+export MAPTHIN
+
+if [ $# -eq 0 ]; then set -- $(cd "$GOLDEN" && ls -d */ | tr -d / | grep -v '^inputs$'); fi
+
+# fails a case if a kept SNP has a missing position of 0 in the given column of any of the files
+noMissingKept() {
+	column=$1
+	shift
+	for f in "$@"; do
+		if ! awk -v c="$column" '$c == 0 { exit 1 }' "$f"; then
+			echo "$f keeps a SNP with a missing position" >&2
+			return 1
+		fi
+	done
+}
+
+# fails a case if the positions in the given column of a file are not sorted within each chromosome
+isSorted() {
+	if ! awk -v c="$1" '$1 == chr && $c < prev { exit 1 } { chr = $1; prev = $c }' "$2"; then
+		echo "$2 is not sorted on column $1" >&2
+		return 1
+	fi
+}
+
+# fails a case if the lines of a thinned file are not in the same order as in the map file
+isInFileOrder() {
+	if ! awk 'NR == FNR { line[$0] = FNR; next } !($0 in line) || line[$0] <= prev { exit 1 } { prev = line[$0] }' "$1" "$2"; then
+		echo "$2 is not in the order of $1" >&2
+		return 1
+	fi
+}
+
+# fails a case if a line of a thinned file is not on the chromosome, or outside base pair positions from and to if given
+isInRegion() {
+	if ! awk -v chr="$1" -v from="$2" -v to="$3" '$1 != chr || (from != "" && ($4 < from + 0 || $4 > to + 0)) { exit 1 }' "$4"; then
+		echo "$4 has SNPs outside the region $1:$2-$3" >&2
+		return 1
+	fi
+}
+
+# fails a case if the JSON report does not give the number of map files read from snapshots
+readFromSnapshots() {
+	if ! grep -q "\"noReadFromSnapshots\": $1," "$2"; then
+		echo "$2 does not have $1 map files read from snapshots" >&2
+		return 1
+	fi
+}
+
+# fails a case if the genotypes in the thinned .bed file are not those of the kept SNPs in the original, given the
+# prefixes of the original and thinned .bim, .bed and .fam files and the number of bytes of each SNP in the .bed files
+bedMatches() {
+	od -An -v -tx1 "$1.bed" | tr -s ' ' '\n' | grep . > "$1.bytes"
+	od -An -v -tx1 "$2.bed" | tr -s ' ' '\n' | grep . > "$2.bytes"
+	if ! cmp -s "$1.fam" "$2.fam" || ! awk -v n="$3" '
+		FILENAME == ARGV[1] { snp[$2] = FNR; next }
+		FILENAME == ARGV[2] { kept[FNR] = snp[$2]; noKept = FNR; next }
+		FILENAME == ARGV[3] { original[FNR] = $1; next }
+		{ byte[FNR] = $1; noBytes = FNR }
+		END {
+			if(noBytes != 3 + noKept*n) exit 1
+			for(k = 1; k <= noKept; ++k) for(b = 1; b <= n; ++b) if(byte[3 + (k - 1)*n + b] != original[3 + (kept[k] - 1)*n + b]) exit 1
+		}' "$1.bim" "$2.bim" "$1.bytes" "$2.bytes"; then
+		echo "$2.bed and $2.fam do not have the genotypes and samples of the SNPs kept from $1" >&2
+		rm -f "$1.bytes" "$2.bytes"
+		return 1
+	fi
+	rm -f "$1.bytes" "$2.bytes"
+}
+
+noCases=0
+noFailed=0
+
+for name in "$@"; do
+	noCases=$((noCases + 1))
+	runDir=$(mktemp -d)
+	cp "$GOLDEN"/inputs/* "$runDir"
+
+	if ! (cd "$runDir" && . "$GOLDEN/$name/run"); then
+		echo "FAILED $name: a run or a check failed"
+		noFailed=$((noFailed + 1))
+		rm -rf "$runDir"
+		continue
+	fi
+
+	# only the files written by the runs are compared
+	for f in "$GOLDEN"/inputs/*; do rm -f "$runDir/$(basename "$f")"; done
+
+	if [ $update -eq 1 ]; then
+		rm -rf "$GOLDEN/$name/expected"
+		cp -r "$runDir" "$GOLDEN/$name/expected"
+		chmod 755 "$GOLDEN/$name/expected"
+		echo "updated $name"
+	elif ! diff -r "$GOLDEN/$name/expected" "$runDir" > "$runDir.diff"; then
+		echo "FAILED $name: the files written are not the expected files"
+		head -20 "$runDir.diff"
+		noFailed=$((noFailed + 1))
+	fi
+
+	rm -rf "$runDir" "$runDir.diff"
+done
+
+echo "goldencheck: $noCases cases, $noFailed failed"
+
+[ $noFailed -eq 0 ]
@@ -0,0 +1,183 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+//! Generates a synthetic map or .bim file for benchmarking and testing MapThin.
+//!
+//! The SNPs are spread over the chromosomes in proportion to their lengths, with
+//! gaps between base pair positions drawn from an exponential distribution and a
+//! recombination rate that varies along each chromosome, so that the genetic
+//! distances are unevenly spread like those of real maps.
+//!
+//! Build from the bench directory with make, or compile with:
+//!	g++ -O3 mapgen.cpp -o mapgen
+//!
+//! Usage: ./mapgen out.map|out.bim noSNPs [options]
+//!	-c n     -- number of chromosomes, 1 to 26 (default 22)
+//!	-m f     -- fraction of SNPs with missing genetic distance and base pair position (default 0)
+//!	-d f     -- fraction of SNPs with the same positions as the previous SNP (default 0)
+//!	-u f     -- fraction of SNPs starting a short unordered segment (default 0)
+//!	-seed n  -- seed for the random numbers (default 1)
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+//! Lengths of the human autosomes in 10^6 base pairs, with the X chromosome as chromosome 23 and shorter made up chromosomes after that.
+static const double chromosomeLengths[26] = {249, 243, 198, 191, 181, 171, 159, 146, 141, 136, 135, 134, 115, 107, 102, 90, 83, 78, 59, 63, 48, 51, 156, 40, 30, 20};
+
+//! Holds the positions of one SNP.
+struct GeneratedSNP
+{
+	double geneticDistance;
+	long basePairPosition;
+};
+
+int main(int argc, char * argv[])
+{
+	if(argc < 3)
+	{
+		cerr << "Usage: ./mapgen out.map|out.bim noSNPs [-c noChromosomes] [-m missing] [-d duplicates] [-u unordered] [-seed n]\n";
+		exit(1);
+	};
+
+	string filename = argv[1];
+	unsigned long noSNPs = strtoul(argv[2], 0, 10);
+	unsigned int noChromosomes = 22;
+	double missing = 0, duplicates = 0, unordered = 0;
+	unsigned long seed = 1;
+
+	for(int a = 3; a + 1 < argc; a += 2)
+	{
+		string option = argv[a];
+		if(option == "-c") noChromosomes = atoi(argv[a + 1]);
+		else if(option == "-m") missing = atof(argv[a + 1]);
+		else if(option == "-d") duplicates = atof(argv[a + 1]);
+		else if(option == "-u") unordered = atof(argv[a + 1]);
+		else if(option == "-seed") seed = strtoul(argv[a + 1], 0, 10);
+		else
+		{
+			cerr << "Unrecognised option: " << option << "\n";
+			exit(1);
+		};
+	};
+
+	if(noChromosomes < 1 || noChromosomes > 26 || noSNPs == 0)
+	{
+		cerr << "The number of SNPs must be positive and the number of chromosomes between 1 and 26!\n";
+		exit(1);
+	};
+
+	bool bim = filename.length() >= 4 && (filename.substr(filename.length()-4) == ".bim" || filename.substr(filename.length()-4) == ".BIM");
+
+	FILE * writeMap = fopen(filename.c_str(), "wb");
+	if(writeMap == 0)
+	{
+		cerr << "Cannot write file: " << filename << "!\n";
+		exit(1);
+	};
+
+	static char buffer[1 << 22];
+	setvbuf(writeMap, buffer, _IOFBF, sizeof(buffer));
+
+	mt19937_64 random(seed);
+	uniform_real_distribution<double> uniform(0, 1);
+	const char alleles[4] = {'A', 'C', 'G', 'T'};
+
+	double totalLength = 0;
+	for(unsigned int c = 0; c < noChromosomes; ++c) totalLength += chromosomeLengths[c];
+
+	unsigned long snpNumber = 0;
+	vector<GeneratedSNP> snps;
+
+	for(unsigned int c = 0; c < noChromosomes; ++c)
+	{
+		unsigned long noChromosomeSNPs = (unsigned long)((double)noSNPs*chromosomeLengths[c]/totalLength);
+		if(c + 1 == noChromosomes) noChromosomeSNPs = noSNPs - snpNumber;
+
+		double meanGap = chromosomeLengths[c]*1e6/(double)(noChromosomeSNPs + 1);
+		double basePairPosition = 0, geneticDistance = 0;
+		double rate = 1; //cM per 10^6 bp, changes along the chromosome to give hot and cold spots
+		exponential_distribution<double> gaps(1.0/meanGap);
+
+		snps.resize(noChromosomeSNPs);
+
+		for(unsigned long s = 0; s < noChromosomeSNPs; ++s)
+		{
+			if(s > 0 && uniform(random) < duplicates)
+			{
+				snps[s] = snps[s - 1];
+				continue;
+			};
+
+			double gap = gaps(random) + 1;
+			if(uniform(random) < 0.01) rate = 0.1 + 3*uniform(random)*uniform(random);
+
+			basePairPosition += gap;
+			geneticDistance += gap*rate*1e-6;
+
+			snps[s].basePairPosition = (long)basePairPosition;
+			snps[s].geneticDistance = geneticDistance;
+		};
+
+		//swap short runs of SNPs out of order
+		if(unordered > 0)
+		{
+			for(unsigned long s = 0; s + 8 < noChromosomeSNPs; ++s)
+			{
+				if(uniform(random) < unordered) reverse(snps.begin() + s, snps.begin() + s + 2 + (unsigned long)(uniform(random)*6));
+			};
+		};
+
+		for(unsigned long s = 0; s < noChromosomeSNPs; ++s)
+		{
+			++snpNumber;
+			bool isMissing = missing > 0 && uniform(random) < missing;
+
+			fprintf(writeMap, "%u\trs%lu\t", c + 1, snpNumber);
+			if(isMissing) fprintf(writeMap, "0\t0");
+			else fprintf(writeMap, "%.6f\t%ld", snps[s].geneticDistance, snps[s].basePairPosition);
+
+			if(bim)
+			{
+				unsigned int allele = (unsigned int)(uniform(random)*4);
+				fprintf(writeMap, "\t%c\t%c", alleles[allele], alleles[(allele + 1 + (unsigned int)(uniform(random)*3)) % 4]);
+			};
+
+			fputc('\n', writeMap);
+		};
+	};
+
+	fclose(writeMap);
+
+	return 0;
+};
@@ -0,0 +1,165 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+//! Micro-benchmark of parsing a map file, compares the per line cost of
+//! reading fields with ifstream and atof against MapFileReader.
+//!
+//! Build from the bench directory with make, or compile with:
+//!	g++ -O3 -pthread -I../src parsebench.cpp ../src/MapFileReader.cpp ../src/Gzip.cpp ../src/ThreadPool.cpp -lz -o parsebench
+//!
+//! Usage: ./parsebench data.map|data.bim [repeats]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "MapFileReader.h"
+
+using namespace std;
+
+//! Returns the time since t in seconds.
+double secondsSince(const chrono::steady_clock::time_point & t)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - t).count();
+};
+
+//! Outputs the time per line and throughput for one way of parsing.
+void report(const string & name, const double & seconds, const unsigned long & noLines, const size_t & noBytes)
+{
+	cout << name << ": " << (seconds*1e9/(double)noLines) << " ns/line, "
+		<< ((double)noBytes/seconds/1e6) << " MB/s\n";
+};
+
+int main(int argc, char * argv[])
+{
+	if(argc < 2)
+	{
+		cerr << "Usage: ./parsebench data.map|data.bim [repeats]\n";
+		exit(1);
+	};
+
+	string filename = argv[1];
+	unsigned int repeats = 5;
+	if(argc > 2) repeats = atoi(argv[2]);
+
+	bool bim = filename.length() >= 4 && (filename.substr(filename.length()-4) == ".bim" || filename.substr(filename.length()-4) == ".BIM");
+	unsigned int noColumns = 4;
+	if(bim) noColumns = 6;
+
+	vector<double> geneticDistances, basePairPositions;
+	string fields[6];
+	unsigned long noLines = 0;
+	size_t noBytes = 0;
+	double bestTime = 1e300, seconds;
+
+	//parse with the ifstream and atof
+	for(unsigned int r = 0; r < repeats; ++r)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		ifstream readMap(filename.c_str());
+		geneticDistances.clear();
+		basePairPositions.clear();
+
+		while(true)
+		{
+			for(unsigned int f = 0; f < noColumns; ++f) readMap >> fields[f];
+			if(readMap.eof()) break;
+			geneticDistances.push_back(atof(fields[2].c_str()));
+			basePairPositions.push_back(atof(fields[3].c_str()));
+		};
+
+		seconds = secondsSince(start);
+		if(seconds < bestTime) bestTime = seconds;
+	};
+
+	noLines = geneticDistances.size();
+	if(noLines == 0)
+	{
+		cerr << "No lines read from " << filename << "!\n";
+		exit(1);
+	};
+
+	MapFileReader readMap;
+	MapLine aLine;
+	readMap.open(filename, bim, false);
+	noBytes = readMap.getSize();
+
+	report("ifstream >> and atof", bestTime, noLines, noBytes);
+
+	//split into fields only
+	bestTime = 1e300;
+	for(unsigned int r = 0; r < repeats; ++r)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		unsigned long noRead = 0;
+		size_t lengths = 0;
+
+		readMap.rewind();
+		while(readMap.readLine(aLine))
+		{
+			lengths += aLine.basePairPosition.length;
+			++noRead;
+		};
+
+		seconds = secondsSince(start);
+		if(seconds < bestTime) bestTime = seconds;
+		if(noRead != noLines || lengths == 0) cerr << "Warning: read " << noRead << " lines instead of " << noLines << "!\n";
+	};
+
+	report("MapFileReader fields", bestTime, noLines, noBytes);
+
+	//split into fields and convert the numbers, checking they are the same as atof
+	unsigned long noDifferent = 0;
+	bestTime = 1e300;
+	for(unsigned int r = 0; r < repeats; ++r)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		unsigned long line = 0;
+		double geneDis, bpp;
+
+		readMap.rewind();
+		while(readMap.readLine(aLine) && line < noLines)
+		{
+			geneDis = aLine.geneticDistance.toDouble();
+			bpp = aLine.basePairPosition.toPosition();
+			if(geneDis != geneticDistances[line] || bpp != basePairPositions[line]) ++noDifferent;
+			++line;
+		};
+
+		seconds = secondsSince(start);
+		if(seconds < bestTime) bestTime = seconds;
+	};
+
+	report("MapFileReader fields and numbers", bestTime, noLines, noBytes);
+
+	cout << "Lines: " << noLines << ", numbers different to atof: " << noDifferent << "\n";
+
+	return noDifferent != 0;
+};
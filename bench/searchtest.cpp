@@ -0,0 +1,190 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+//! Differential test of thinning to a target number or percentage of SNPs, the -s and -p options. Checks that
+//! thinning with several threads keeps exactly the same SNPs, at the same SNPs per cM, as thinning with one thread.
+//!
+//! The SNPs are made up like those of mapgen, on many chromosomes, on one chromosome large enough to be thinned in
+//! parallel segments, with missing and duplicate positions, on base pair positions and with scores.
+//!
+//! Build and run from the bench directory with make check, or compile with:
+//!	g++ -O3 -pthread -I../src searchtest.cpp ../src/SNPThinner.cpp ../src/SNPSorter.cpp ../src/GapStats.cpp ../src/RunReport.cpp ../src/ThreadPool.cpp -o searchtest
+//!
+//! Usage: ./searchtest [noSNPs] [seed]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <math.h>
+
+#include "SNPThinner.h"
+
+using namespace std;
+
+//! Holds the settings of the SNPs made up for one test.
+struct SearchTestCase
+{
+	string name;
+	unsigned int noChromosomes;
+	double missing; //fraction of SNPs with a missing position
+	double duplicates; //fraction of SNPs with the same position as the SNP before
+	bool basePair; //thin on base pair position rather than genetic distance
+	bool scores;
+
+	SearchTestCase(const string & nm, const unsigned int & nc, const double & mi, const double & du, const bool & bp, const bool & sc)
+		: name(nm), noChromosomes(nc), missing(mi), duplicates(du), basePair(bp), scores(sc) {};
+
+	~SearchTestCase() {};
+};
+
+//! Holds the SNPs made up for one chromosome.
+struct TestChromosome
+{
+	vector<double> positions;
+	vector<float> scores;
+};
+
+//! Makes up the SNPs of a test, with exponential gaps and a recombination rate that changes along each chromosome.
+void makeChromosomes(const SearchTestCase & testCase, const unsigned long & noSNPs, mt19937_64 & random, vector<TestChromosome> & chromosomes)
+{
+	uniform_real_distribution<double> uniform(0, 1);
+	exponential_distribution<double> gaps(1.0/100000);
+
+	chromosomes.assign(testCase.noChromosomes, TestChromosome());
+
+	for(unsigned int c = 0; c < testCase.noChromosomes; ++c)
+	{
+		unsigned long noChromosomeSNPs = noSNPs/testCase.noChromosomes;
+		double basePairPosition = 0, geneticDistance = 0, position = 0;
+		double rate = 1;
+
+		for(unsigned long s = 0; s < noChromosomeSNPs; ++s)
+		{
+			if(s == 0 || uniform(random) >= testCase.duplicates)
+			{
+				double gap = gaps(random) + 1;
+				if(uniform(random) < 0.01) rate = 0.1 + 3*uniform(random)*uniform(random);
+
+				basePairPosition += gap;
+				geneticDistance += gap*rate*1e-6;
+
+				//positions are rounded as they are written in map files, so some are tied
+				if(testCase.basePair) position = floor(basePairPosition);
+				else position = floor(geneticDistance*1e6 + 0.5)*1e-6;
+			};
+
+			if(testCase.missing > 0 && uniform(random) < testCase.missing) chromosomes[c].positions.push_back(0);
+			else chromosomes[c].positions.push_back(position);
+
+			if(testCase.scores) chromosomes[c].scores.push_back((float)uniform(random));
+		};
+	};
+};
+
+//! Thins the SNPs to a target with a number of threads, returning the SNPs kept and the SNPs per cM used.
+ThinStatus thinToTarget(const SearchTestCase & testCase, const vector<TestChromosome> & chromosomes, const unsigned int & noThreads, const bool & percent,
+	const double & target, vector<size_t> & thinnedSNPs, double & snpsPerCM)
+{
+	SNPThinner thinner(testCase.basePair, noThreads);
+
+	for(unsigned int c = 0; c < chromosomes.size(); ++c)
+	{
+		const float * scores = testCase.scores ? &chromosomes[c].scores[0] : 0;
+		thinner.addChromosome(to_string(c + 1), &chromosomes[c].positions[0], chromosomes[c].positions.size(), scores);
+	};
+
+	ThinStatus status;
+	if(percent) status = thinner.thinToTargetPercentNoSNPs(target);
+	else status = thinner.thinToTargetNoSNPs((unsigned int)target);
+
+	thinner.getThinnedSNPs(thinnedSNPs);
+	snpsPerCM = thinner.getSNPsPerCM();
+
+	return status;
+};
+
+int main(int argc, char * argv[])
+{
+	unsigned long noSNPs = 300000; //the chromosome of the 1 chromosome test is split into segments with more than one thread
+	unsigned long seed = 1;
+	if(argc > 1) noSNPs = strtoul(argv[1], 0, 10);
+	if(argc > 2) seed = strtoul(argv[2], 0, 10);
+
+	vector<SearchTestCase> testCases;
+	testCases.push_back(SearchTestCase("22 chromosomes", 22, 0, 0, false, false));
+	testCases.push_back(SearchTestCase("1 chromosome", 1, 0, 0, false, false));
+	testCases.push_back(SearchTestCase("missing and duplicates", 22, 0.02, 0.1, false, false));
+	testCases.push_back(SearchTestCase("base pair position", 4, 0, 0.05, true, false));
+	testCases.push_back(SearchTestCase("scores", 22, 0, 0, false, true));
+
+	const double percents[] = {1, 10, 40, 71, 85}; //all can be kept with the missing and duplicate positions
+	const unsigned int threads[] = {2, 3, 4, 8};
+
+	mt19937_64 random(seed);
+	vector<TestChromosome> chromosomes;
+	vector<size_t> thinnedSNPs, thinnedSNPsOneThread;
+	double snpsPerCM, snpsPerCMOneThread;
+	unsigned int noRuns = 0, noDifferences = 0;
+
+	for(vector<SearchTestCase>::const_iterator testCase = testCases.begin(); testCase != testCases.end(); ++testCase)
+	{
+		makeChromosomes(*testCase, noSNPs, random, chromosomes);
+
+		//each percentage is tried with -p, and the number of SNPs it gives with -s
+		for(unsigned int p = 0; p < sizeof(percents)/sizeof(percents[0]); ++p)
+		{
+			for(unsigned int mode = 0; mode < 2; ++mode)
+			{
+				bool percent = mode == 0;
+				double target = percent ? percents[p] : floor(noSNPs*percents[p]*0.01) + 1;
+
+				ThinStatus statusOneThread = thinToTarget(*testCase, chromosomes, 1, percent, target, thinnedSNPsOneThread, snpsPerCMOneThread);
+
+				for(unsigned int t = 0; t < sizeof(threads)/sizeof(threads[0]); ++t)
+				{
+					ThinStatus status = thinToTarget(*testCase, chromosomes, threads[t], percent, target, thinnedSNPs, snpsPerCM);
+					++noRuns;
+
+					if(status != statusOneThread || snpsPerCM != snpsPerCMOneThread || thinnedSNPs != thinnedSNPsOneThread)
+					{
+						++noDifferences;
+						cout << "Different with " << threads[t] << " threads: " << testCase->name << ", " << (percent ? "-p " : "-s ") << target
+							<< ", kept " << thinnedSNPs.size() << " SNPs rather than " << thinnedSNPsOneThread.size() << "\n";
+					};
+				};
+			};
+		};
+	};
+
+	cout << "searchtest: " << noRuns << " runs with several threads, " << noDifferences << " different from one thread\n";
+
+	if(noDifferences > 0) exit(1);
+
+	return 0;
+};
@@ -0,0 +1,247 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+//! Benchmark of the MapThin executable, times each way of thinning on a map file and
+//! reports the throughput and peak memory. If a reference executable is given, such as one
+//! built from an earlier version, its output files and screen output are compared byte for
+//! byte with those of the executable being tested.
+//!
+//! Build from the bench directory with make, or compile with:
+//!	g++ -O3 thinbench.cpp -o thinbench
+//!
+//! Usage: ./thinbench mapthin data.map|data.bim [reference-mapthin] [-- options for every run]
+//!
+//! Runs are done in the directory thinbench-runs, which is made if needed. Runs on Linux and
+//! other POSIX systems only.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! Holds the time and peak memory of one run.
+struct RunResult
+{
+	double seconds;
+	long peakKB;
+	int exitStatus;
+};
+
+//! Runs a program in a directory with its screen output sent to a file, returns the time and peak memory.
+RunResult runProgram(const vector<string> & arguments, const string & directory, const string & screenFile)
+{
+	RunResult result = {0, 0, -1};
+	vector<char *> argv;
+	for(vector<string>::const_iterator a = arguments.begin(); a != arguments.end(); ++a) argv.push_back((char *)a->c_str());
+	argv.push_back(0);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		if(chdir(directory.c_str()) != 0) _exit(127);
+
+		int fd = open(screenFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if(fd >= 0)
+		{
+			dup2(fd, 1);
+			dup2(fd, 2);
+			close(fd);
+		};
+
+		execv(argv[0], &argv[0]);
+		_exit(127);
+	};
+
+	if(pid < 0) return result;
+
+	int status = 0;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	result.peakKB = usage.ru_maxrss;
+	result.exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+	return result;
+};
+
+//! Returns the contents of a file, or an empty string if it does not exist.
+string readWholeFile(const string & filename)
+{
+	ifstream readFile(filename.c_str(), ios::binary);
+	ostringstream contents;
+	contents << readFile.rdbuf();
+	return contents.str();
+};
+
+//! Returns the absolute path of a file.
+string getAbsolutePath(const string & filename)
+{
+	if(!filename.empty() && filename[0] == '/') return filename;
+
+	char directory[4096];
+	if(getcwd(directory, sizeof(directory)) == 0) return filename;
+
+	return string(directory) + "/" + filename;
+};
+
+//! Compares one output file of the tested and reference runs, returns true if they are the same.
+bool sameOutput(const string & testFile, const string & referenceFile, const string & description)
+{
+	if(readWholeFile(testFile) == readWholeFile(referenceFile)) return true;
+
+	cout << "  DIFFERENT " << description << ": " << testFile << " and " << referenceFile << "\n";
+	return false;
+};
+
+int main(int argc, char * argv[])
+{
+	vector<string> positional, extraOptions;
+	bool afterDashes = false;
+
+	for(int a = 1; a < argc; ++a)
+	{
+		if(!afterDashes && string(argv[a]) == "--") afterDashes = true;
+		else if(afterDashes) extraOptions.push_back(argv[a]);
+		else positional.push_back(argv[a]);
+	};
+
+	if(positional.size() < 2)
+	{
+		cerr << "Usage: ./thinbench mapthin data.map|data.bim [reference-mapthin] [-- options for every run]\n";
+		exit(1);
+	};
+
+	string program = getAbsolutePath(positional[0]);
+	string inputFile = getAbsolutePath(positional[1]);
+	string referenceProgram;
+	if(positional.size() > 2) referenceProgram = getAbsolutePath(positional[2]);
+
+	bool bim = inputFile.length() >= 4 && (inputFile.substr(inputFile.length()-4) == ".bim" || inputFile.substr(inputFile.length()-4) == ".BIM");
+	string extension = bim ? ".bim" : ".map";
+
+	//count the lines of the input for the throughput
+	string input = readWholeFile(inputFile);
+	unsigned long noLines = 0;
+	for(string::const_iterator c = input.begin(); c != input.end(); ++c) if(*c == '\n') ++noLines;
+	size_t noBytes = input.size();
+	input = string();
+
+	if(noLines == 0)
+	{
+		cerr << "No lines in " << inputFile << "!\n";
+		exit(1);
+	};
+
+	ostringstream tenthOfSNPs;
+	tenthOfSNPs << (noLines/10 > 0 ? noLines/10 : 1);
+
+	//the ways of thinning to time, each is run with any extra options
+	vector< vector<string> > modes;
+	modes.push_back(vector<string>(1, "-t")); modes.back().push_back("2");
+	modes.push_back(vector<string>(1, "-b")); modes.back().push_back("2");
+	modes.push_back(vector<string>(1, "-s")); modes.back().push_back(tenthOfSNPs.str());
+	modes.push_back(vector<string>(1, "-p")); modes.back().push_back("50");
+	modes.push_back(vector<string>(1, "-p")); modes.back().push_back("90");
+	modes.push_back(vector<string>(1, "-b")); modes.back().push_back("-p"); modes.back().push_back("50");
+	modes.push_back(vector<string>(1, "-n")); modes.back().push_back("-p"); modes.back().push_back("50");
+
+	mkdir("thinbench-runs", 0777);
+
+	cout << "Input: " << inputFile << ", " << noLines << " lines, " << ((double)noBytes/1e6) << " MB\n\n";
+
+	unsigned int noDifferent = 0;
+	unsigned int noFailed = 0;
+
+	for(size_t m = 0; m < modes.size(); ++m)
+	{
+		string modeName;
+		for(vector<string>::const_iterator o = modes[m].begin(); o != modes[m].end(); ++o) modeName += (o == modes[m].begin() ? "" : " ") + *o;
+
+		ostringstream testDirectory, referenceDirectory;
+		testDirectory << "thinbench-runs/test" << m;
+		referenceDirectory << "thinbench-runs/reference" << m;
+		mkdir(testDirectory.str().c_str(), 0777);
+
+		vector<string> arguments(1, program);
+		arguments.insert(arguments.end(), modes[m].begin(), modes[m].end());
+		arguments.insert(arguments.end(), extraOptions.begin(), extraOptions.end());
+		arguments.push_back(inputFile);
+		arguments.push_back("thinned" + extension);
+
+		RunResult result = runProgram(arguments, testDirectory.str(), "screen.txt");
+
+		printf("%-12s %8.3f s %12.0f lines/s %9.1f MB/s %9ld KB peak", modeName.c_str(), result.seconds,
+			(double)noLines/result.seconds, (double)noBytes/result.seconds/1e6, result.peakKB);
+		if(result.exitStatus != 0)
+		{
+			printf("  (exit status %d)", result.exitStatus);
+			++noFailed;
+		};
+		printf("\n");
+		fflush(stdout);
+
+		if(referenceProgram.empty()) continue;
+
+		//run the reference on the same options and compare every file written
+		mkdir(referenceDirectory.str().c_str(), 0777);
+		arguments[0] = referenceProgram;
+		runProgram(arguments, referenceDirectory.str(), "screen.txt");
+
+		const char * outputs[4] = {"thinned", "screen.txt", "missingGeneticDis.txt", "missingBasePairPosition.txt"};
+		for(unsigned int o = 0; o < 4; ++o)
+		{
+			string outputName = outputs[o];
+			if(outputName == "thinned") outputName += extension;
+			if(!sameOutput(testDirectory.str() + "/" + outputName, referenceDirectory.str() + "/" + outputName, modeName)) ++noDifferent;
+		};
+	};
+
+	if(!referenceProgram.empty())
+	{
+		if(noDifferent == 0) cout << "\nAll output is the same as the reference.\n";
+		else cout << "\n" << noDifferent << " output files are different to the reference!\n";
+	};
+
+	return noDifferent != 0 || noFailed != 0;
+};
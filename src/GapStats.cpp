@@ -0,0 +1,138 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "GapStats.h"
+
+#include <vector>
+#include <math.h>
+
+using namespace std;
+
+//! Removes all gaps.
+void GapStats::clear()
+{
+	noGaps = 0;
+	mean = 0;
+	sumSquares = 0;
+	minGap = 0;
+	maxGap = 0;
+	histogram.clear();
+};
+
+//! Adds one gap between SNPs.
+void GapStats::add(const double & gap)
+{
+	if(histogram.empty()) histogram.resize(getNoBins(), 0);
+
+	if(noGaps == 0 || gap < minGap) minGap = gap;
+	if(noGaps == 0 || gap > maxGap) maxGap = gap;
+
+	noGaps++;
+	double delta = gap - mean;
+	mean += delta/(double)noGaps;
+	sumSquares += delta*(gap - mean);
+
+	histogram[getBin(gap)]++;
+};
+
+//! Adds the gaps of other statistics, such as those of another chromosome.
+void GapStats::merge(const GapStats & gapStats)
+{
+	if(gapStats.noGaps == 0) return;
+
+	if(noGaps == 0)
+	{
+		*this = gapStats;
+		return;
+	};
+
+	double total = (double)(noGaps + gapStats.noGaps);
+	double delta = gapStats.mean - mean;
+
+	mean += delta*(double)gapStats.noGaps/total;
+	sumSquares += gapStats.sumSquares + delta*delta*(double)noGaps*(double)gapStats.noGaps/total;
+	noGaps += gapStats.noGaps;
+
+	if(gapStats.minGap < minGap) minGap = gapStats.minGap;
+	if(gapStats.maxGap > maxGap) maxGap = gapStats.maxGap;
+
+	for(unsigned int b = 0; b < histogram.size(); ++b) histogram[b] += gapStats.histogram[b];
+};
+
+//! Returns the histogram bin for a gap.
+unsigned int GapStats::getBin(const double & gap)
+{
+	if(!(gap > 0)) return 0;
+
+	int exponent;
+	double fraction = frexp(gap, &exponent); //gap = fraction*2^exponent, with fraction in [0.5, 1)
+	int octave = exponent - 1;
+
+	if(octave < minOctave) return 0;
+	if(octave >= maxOctave) return (maxOctave - minOctave)*binsPerOctave + 1;
+
+	return (octave - minOctave)*binsPerOctave + (unsigned int)((fraction*2 - 1)*binsPerOctave) + 1;
+};
+
+//! Returns the smallest gap in a histogram bin.
+double GapStats::getBinLowerLimit(const unsigned int & bin)
+{
+	if(bin == 0) return 0;
+
+	unsigned int octave = (bin - 1)/binsPerOctave;
+	unsigned int subBin = (bin - 1) % binsPerOctave;
+
+	return ldexp(1.0 + (double)subBin/(double)binsPerOctave, octave + minOctave);
+};
+
+//! Returns an approximate quantile of the gaps, the middle of the histogram bin containing it, to within about 6%.
+double GapStats::getQuantile(const double & q) const
+{
+	if(noGaps == 0) return 0;
+
+	unsigned long rank = (unsigned long)ceil(q*(double)noGaps);
+	if(rank < 1) rank = 1;
+
+	unsigned long cumulative = 0;
+	double quantile = maxGap;
+
+	for(unsigned int b = 0; b < histogram.size(); ++b)
+	{
+		cumulative += histogram[b];
+		if(cumulative >= rank)
+		{
+			if(b == 0 || b + 1 == histogram.size()) quantile = (b == 0) ? minGap : maxGap;
+			else quantile = (getBinLowerLimit(b) + getBinLowerLimit(b + 1))*0.5;
+			break;
+		};
+	};
+
+	if(quantile < minGap) quantile = minGap;
+	if(quantile > maxGap) quantile = maxGap;
+
+	return quantile;
+};
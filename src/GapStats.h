@@ -0,0 +1,64 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __GAPSTATS
+#define __GAPSTATS
+
+#include <vector>
+
+using namespace std;
+
+//! Class to gather statistics of the gaps between SNPs in one pass, using a fixed amount of memory.
+//! The mean and variance are updated with Welford's method, and the gaps are counted in a histogram
+//! with bins evenly spaced on a log scale for approximate quantiles.
+struct GapStats
+{
+	unsigned long noGaps;
+	double mean;
+	double sumSquares; //sum of squared differences from the mean
+	double minGap, maxGap;
+	vector<unsigned long> histogram;
+
+	static const int minOctave = -32; //gaps smaller than 2^minOctave, or not positive, go in the first bin
+	static const int maxOctave = 48; //gaps from 2^maxOctave go in the last bin
+	static const unsigned int binsPerOctave = 8;
+
+	GapStats() : noGaps(0), mean(0), sumSquares(0), minGap(0), maxGap(0), histogram() {};
+
+	~GapStats() {};
+
+	void clear();
+	void add(const double & gap);
+	void merge(const GapStats & gapStats);
+	double getSquaresAbout(const double & centre) const {return sumSquares + (double)noGaps*(mean - centre)*(mean - centre);};
+	double getQuantile(const double & q) const;
+	unsigned int getNoBins() const {return (maxOctave - minOctave)*binsPerOctave + 2;};
+	static unsigned int getBin(const double & gap);
+	static double getBinLowerLimit(const unsigned int & bin);
+};
+
+#endif
@@ -0,0 +1,493 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "Gzip.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+#ifndef NO_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+#ifdef NO_ZLIB
+const bool gzipSupported = false;
+#else
+const bool gzipSupported = true;
+#endif
+
+//! The empty block that ends a BGZF file.
+static const unsigned char bgzfEndOfFile[28] = {0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 0x06, 0, 0x42, 0x43, 0x02, 0, 0x1b, 0, 0x03, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+//! Returns the little endian number of 2 bytes.
+static inline unsigned int getUInt16(const unsigned char * bytes)
+{
+	return bytes[0] | (bytes[1] << 8);
+};
+
+//! Returns the little endian number of 4 bytes.
+static inline uint32_t getUInt32(const unsigned char * bytes)
+{
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+};
+
+//! Stores a number as 4 little endian bytes.
+static inline void setUInt32(unsigned char * bytes, const uint32_t & number)
+{
+	bytes[0] = number & 0xff;
+	bytes[1] = (number >> 8) & 0xff;
+	bytes[2] = (number >> 16) & 0xff;
+	bytes[3] = (number >> 24) & 0xff;
+};
+
+//! Returns whether the data starts like a gzip file.
+bool isGzipData(const char * data, const size_t & size)
+{
+	return size >= 2 && (unsigned char)data[0] == 0x1f && (unsigned char)data[1] == 0x8b;
+};
+
+//! Returns whether a file name ends with .gz or .bgz, which are written compressed.
+bool isCompressedFileName(const string & filename)
+{
+	return removeCompressedExtension(filename) != filename;
+};
+
+//! Returns the file name without a .gz or .bgz ending.
+string removeCompressedExtension(const string & filename)
+{
+	size_t length = filename.length();
+
+	if(length >= 3 && (filename.substr(length-3) == ".gz" || filename.substr(length-3) == ".GZ")) return filename.substr(0, length-3);
+	if(length >= 4 && (filename.substr(length-4) == ".bgz" || filename.substr(length-4) == ".BGZ")) return filename.substr(0, length-4);
+
+	return filename;
+};
+
+#ifndef NO_ZLIB
+
+//! Class to store where one BGZF block is and where its data goes.
+struct BGZFBlock
+{
+	size_t start; //of the compressed data in the file
+	size_t length; //of the compressed data
+	size_t dataPosition; //in the decompressed data
+	size_t dataSize;
+	uint32_t crc;
+
+	BGZFBlock() : start(0), length(0), dataPosition(0), dataSize(0), crc(0) {};
+	BGZFBlock(const size_t & st, const size_t & len, const size_t & dp, const size_t & ds, const uint32_t & cr) : start(st), length(len), dataPosition(dp), dataSize(ds), crc(cr) {};
+
+	~BGZFBlock() {};
+};
+
+//! Finds the BGZF block starting at the given position, returns false if there is not a BGZF block there.
+static bool getBGZFBlock(const unsigned char * compressed, const size_t & compressedSize, const size_t & position, const size_t & dataPosition, BGZFBlock & block, size_t & blockSize)
+{
+	const unsigned char * header = compressed + position;
+
+	if(compressedSize - position < 18 || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || header[3] != 4) return false;
+
+	//find the BC field giving the block size in the extra fields
+	size_t extraLength = getUInt16(header + 10);
+	blockSize = 0;
+
+	if(compressedSize - position < 12 + extraLength) return false;
+
+	for(size_t field = 0; field + 4 <= extraLength; field += 4 + getUInt16(header + 12 + field + 2))
+	{
+		if(header[12 + field] == 'B' && header[12 + field + 1] == 'C' && getUInt16(header + 12 + field + 2) == 2)
+		{
+			blockSize = getUInt16(header + 12 + field + 4) + 1;
+			break;
+		};
+	};
+
+	if(blockSize < 12 + extraLength + 8 || compressedSize - position < blockSize) return false;
+
+	block = BGZFBlock(position + 12 + extraLength, blockSize - 12 - extraLength - 8, dataPosition, getUInt32(header + blockSize - 4), getUInt32(header + blockSize - 8));
+
+	return true;
+};
+
+//! Finds the blocks of a BGZF file, returns false if the data is not all BGZF blocks.
+static bool getBGZFBlocks(const unsigned char * compressed, const size_t & compressedSize, vector<BGZFBlock> & blocks, size_t & size)
+{
+	size_t position = 0;
+	size_t blockSize;
+	BGZFBlock block;
+
+	size = 0;
+
+	while(position < compressedSize)
+	{
+		if(!getBGZFBlock(compressed, compressedSize, position, size, block, blockSize)) return false;
+
+		blocks.push_back(block);
+		size += block.dataSize;
+		position += blockSize;
+	};
+
+	return true;
+};
+
+//! Decompresses one BGZF block, returns false if it is corrupt.
+static bool decompressBGZFBlock(const unsigned char * compressed, const BGZFBlock & block, char * data)
+{
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+
+	if(inflateInit2(&stream, -15) != Z_OK) return false;
+
+	stream.next_in = (Bytef *)(compressed + block.start);
+	stream.avail_in = block.length;
+	stream.next_out = (Bytef *)(data + block.dataPosition);
+	stream.avail_out = block.dataSize;
+
+	int result = inflate(&stream, Z_FINISH);
+	bool ok = (result == Z_STREAM_END && stream.total_out == block.dataSize);
+
+	inflateEnd(&stream);
+
+	return ok && crc32(0, (const Bytef *)(data + block.dataPosition), block.dataSize) == block.crc;
+};
+
+//! Decompresses gzip data that is not BGZF, one or more gzip members one after the other.
+static bool decompressGzipStream(const unsigned char * compressed, const size_t & compressedSize, char * & data, size_t & size)
+{
+	size_t capacity = compressedSize*4 + (1 << 16);
+	data = (char *)malloc(capacity);
+	size = 0;
+
+	if(data == 0) return false;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+
+	if(inflateInit2(&stream, 15 + 32) != Z_OK)
+	{
+		free(data);
+		return false;
+	};
+
+	stream.next_in = (Bytef *)compressed;
+	stream.avail_in = compressedSize;
+
+	int result = Z_OK;
+
+	while(true)
+	{
+		if(size == capacity)
+		{
+			char * biggerData = (char *)realloc(data, capacity*2);
+			if(biggerData == 0) break;
+			data = biggerData;
+			capacity *= 2;
+		};
+
+		stream.next_out = (Bytef *)(data + size);
+		stream.avail_out = capacity - size;
+
+		result = inflate(&stream, Z_NO_FLUSH);
+		size = capacity - stream.avail_out;
+
+		//start again for another gzip member
+		if(result == Z_STREAM_END && stream.avail_in > 0 && isGzipData((const char *)stream.next_in, stream.avail_in))
+		{
+			inflateReset(&stream);
+			continue;
+		};
+
+		if(result != Z_OK && !(result == Z_BUF_ERROR && stream.avail_out == 0)) break;
+	};
+
+	inflateEnd(&stream);
+
+	if(result != Z_STREAM_END)
+	{
+		free(data);
+		data = 0;
+		size = 0;
+		return false;
+	};
+
+	return true;
+};
+
+//! Decompresses gzip data into a new buffer to be freed with free, BGZF blocks are decompressed in parallel.
+bool decompressGzip(const char * compressed, const size_t & compressedSize, char * & data, size_t & size, ThreadPool * threadPool)
+{
+	const unsigned char * bytes = (const unsigned char *)compressed;
+	vector<BGZFBlock> blocks;
+
+	if(!getBGZFBlocks(bytes, compressedSize, blocks, size)) return decompressGzipStream(bytes, compressedSize, data, size);
+
+	data = (char *)malloc(size > 0 ? size : 1);
+	if(data == 0) return false;
+
+	vector<char> blockOK(blocks.size(), 0);
+
+	function<void(size_t)> decompressBlock = [&](size_t b) { blockOK[b] = decompressBGZFBlock(bytes, blocks[b], data); };
+
+	if(threadPool != 0) threadPool->run(blocks.size(), decompressBlock);
+	else for(size_t b = 0; b < blocks.size(); ++b) decompressBlock(b);
+
+	for(size_t b = 0; b < blocks.size(); ++b)
+	{
+		if(!blockOK[b])
+		{
+			free(data);
+			data = 0;
+			size = 0;
+			return false;
+		};
+	};
+
+	return true;
+};
+
+//! Compresses up to bgzfBlockDataSize bytes into a BGZF block, the block must have room for bgzfMaxBlockSize bytes, returns the size of the block.
+size_t compressBGZFBlock(const char * data, const size_t & size, char * block)
+{
+	unsigned char * header = (unsigned char *)block;
+	const unsigned char headerStart[16] = {0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 0x06, 0, 0x42, 0x43, 0x02, 0};
+	memcpy(header, headerStart, 16);
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+	stream.next_in = (Bytef *)data;
+	stream.avail_in = size;
+	stream.next_out = (Bytef *)(block + 18);
+	stream.avail_out = bgzfMaxBlockSize - 18 - 8;
+
+	int result = deflate(&stream, Z_FINISH);
+	size_t compressedSize = stream.total_out;
+	deflateEnd(&stream);
+
+	//data that does not compress is stored
+	if(result != Z_STREAM_END)
+	{
+		deflateInit2(&stream, Z_NO_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+		stream.next_in = (Bytef *)data;
+		stream.avail_in = size;
+		stream.next_out = (Bytef *)(block + 18);
+		stream.avail_out = bgzfMaxBlockSize - 18 - 8;
+		deflate(&stream, Z_FINISH);
+		compressedSize = stream.total_out;
+		deflateEnd(&stream);
+	};
+
+	size_t blockSize = 18 + compressedSize + 8;
+
+	header[16] = (blockSize - 1) & 0xff;
+	header[17] = ((blockSize - 1) >> 8) & 0xff;
+	setUInt32(header + 18 + compressedSize, crc32(0, (const Bytef *)data, size));
+	setUInt32(header + 18 + compressedSize + 4, size);
+
+	return blockSize;
+};
+
+//! Starts decompressing gzip data, the data must not change while it is being decompressed.
+GzipStream::GzipStream(const char * cmp, const size_t & cs, ThreadPool * tp) : compressed((const unsigned char *)cmp), compressedSize(cs), position(0), bgzf(false), streamEnded(false), stream(0), threadPool(tp)
+{
+	BGZFBlock block;
+	size_t blockSize;
+
+	bgzf = getBGZFBlock(compressed, compressedSize, 0, 0, block, blockSize);
+
+	if(!bgzf)
+	{
+		z_stream * zStream = new z_stream;
+		memset(zStream, 0, sizeof(z_stream));
+
+		if(inflateInit2(zStream, 15 + 32) != Z_OK)
+		{
+			delete zStream;
+			return;
+		};
+
+		zStream->next_in = (Bytef *)compressed;
+		zStream->avail_in = compressedSize;
+		stream = zStream;
+	};
+};
+
+//! Frees the zlib stream.
+GzipStream::~GzipStream()
+{
+	if(stream != 0)
+	{
+		inflateEnd((z_stream *)stream);
+		delete (z_stream *)stream;
+	};
+};
+
+//! Starts decompressing again from the start of the data.
+void GzipStream::rewind()
+{
+	position = 0;
+	streamEnded = false;
+
+	if(stream != 0)
+	{
+		z_stream * zStream = (z_stream *)stream;
+		inflateReset(zStream);
+		zStream->next_in = (Bytef *)compressed;
+		zStream->avail_in = compressedSize;
+	};
+};
+
+//! Decompresses the next data into the buffer, noRead is 0 at the end of the data. Returns false if the data is corrupt.
+bool GzipStream::read(char * buffer, const size_t & capacity, size_t & noRead)
+{
+	noRead = 0;
+
+	if(bgzf) return readBGZF(buffer, capacity, noRead);
+
+	return readStream(buffer, capacity, noRead);
+};
+
+//! Decompresses as many of the next BGZF blocks as fit in the buffer, in parallel. The buffer should have room for at least one block.
+bool GzipStream::readBGZF(char * buffer, const size_t & capacity, size_t & noRead)
+{
+	vector<BGZFBlock> blocks;
+	BGZFBlock block;
+	size_t blockSize;
+
+	while(position < compressedSize)
+	{
+		if(!getBGZFBlock(compressed, compressedSize, position, noRead, block, blockSize)) return false;
+		if(noRead + block.dataSize > capacity) break;
+
+		blocks.push_back(block);
+		noRead += block.dataSize;
+		position += blockSize;
+	};
+
+	if(blocks.empty() && position < compressedSize) return false;
+
+	vector<char> blockOK(blocks.size(), 0);
+
+	function<void(size_t)> decompressBlock = [&](size_t b) { blockOK[b] = decompressBGZFBlock(compressed, blocks[b], buffer); };
+
+	if(threadPool != 0) threadPool->run(blocks.size(), decompressBlock);
+	else for(size_t b = 0; b < blocks.size(); ++b) decompressBlock(b);
+
+	for(size_t b = 0; b < blocks.size(); ++b)
+	{
+		if(!blockOK[b]) return false;
+	};
+
+	return true;
+};
+
+//! Decompresses gzip data that is not BGZF until the buffer is full, one or more gzip members one after the other.
+bool GzipStream::readStream(char * buffer, const size_t & capacity, size_t & noRead)
+{
+	if(stream == 0) return false;
+	if(streamEnded) return true;
+
+	z_stream * zStream = (z_stream *)stream;
+	zStream->next_out = (Bytef *)buffer;
+	zStream->avail_out = capacity;
+
+	while(zStream->avail_out > 0)
+	{
+		int result = inflate(zStream, Z_NO_FLUSH);
+
+		if(result == Z_STREAM_END)
+		{
+			//start again for another gzip member
+			if(zStream->avail_in > 0 && isGzipData((const char *)zStream->next_in, zStream->avail_in))
+			{
+				inflateReset(zStream);
+				continue;
+			};
+
+			streamEnded = true;
+			break;
+		};
+
+		if(result != Z_OK) return false;
+	};
+
+	noRead = capacity - zStream->avail_out;
+
+	return true;
+};
+
+#else
+
+//! Without zlib compressed files cannot be read.
+bool decompressGzip(const char *, const size_t &, char * &, size_t &, ThreadPool *)
+{
+	return false;
+};
+
+//! Without zlib compressed files cannot be read.
+GzipStream::GzipStream(const char * cmp, const size_t & cs, ThreadPool * tp) : compressed((const unsigned char *)cmp), compressedSize(cs), position(0), bgzf(false), streamEnded(false), stream(0), threadPool(tp)
+{
+
+};
+
+GzipStream::~GzipStream()
+{
+
+};
+
+void GzipStream::rewind()
+{
+
+};
+
+bool GzipStream::read(char *, const size_t &, size_t & noRead)
+{
+	noRead = 0;
+	return false;
+};
+
+//! Without zlib compressed files cannot be written.
+size_t compressBGZFBlock(const char *, const size_t &, char *)
+{
+	return 0;
+};
+
+#endif
+
+//! Sets the empty block that ends a BGZF file.
+void getBGZFEndOfFile(const char * & block, size_t & size)
+{
+	block = (const char *)bgzfEndOfFile;
+	size = sizeof(bgzfEndOfFile);
+};
@@ -0,0 +1,80 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __GZIP
+#define __GZIP
+
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+//! Largest amount of data in one BGZF block, as used by samtools and htslib.
+const size_t bgzfBlockDataSize = 65280;
+
+//! Largest size of a compressed BGZF block.
+const size_t bgzfMaxBlockSize = 65536;
+
+extern const bool gzipSupported; //false if compiled with NO_ZLIB
+
+//! Class for decompressing gzip data a piece at a time, so that all of the decompressed data is never in memory at once.
+//! BGZF blocks are decompressed in parallel using the threads of the thread pool, if given.
+class GzipStream
+{
+private:
+	const unsigned char * compressed;
+	size_t compressedSize;
+	size_t position; //of the next compressed data to decompress
+	bool bgzf;
+	bool streamEnded;
+	void * stream; //zlib stream used for gzip data that is not BGZF
+	ThreadPool * threadPool;
+
+	bool readBGZF(char * buffer, const size_t & capacity, size_t & noRead);
+	bool readStream(char * buffer, const size_t & capacity, size_t & noRead);
+
+public:
+
+	GzipStream(const char * cmp, const size_t & cs, ThreadPool * tp);
+
+	~GzipStream();
+
+	void rewind();
+	void setThreadPool(ThreadPool * tp) {threadPool = tp;};
+	bool read(char * buffer, const size_t & capacity, size_t & noRead);
+};
+
+bool isGzipData(const char * data, const size_t & size);
+bool isCompressedFileName(const string & filename);
+string removeCompressedExtension(const string & filename);
+bool decompressGzip(const char * compressed, const size_t & compressedSize, char * & data, size_t & size, ThreadPool * threadPool);
+size_t compressBGZFBlock(const char * data, const size_t & size, char * block);
+void getBGZFEndOfFile(const char * & block, size_t & size);
+
+#endif
@@ -0,0 +1,122 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+#include "MapFileIndex.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <sys/stat.h>
+
+using namespace std;
+
+//! Gets the size and modified time of a file, returns false if the file cannot be found.
+bool MapFileIndex::getFileStatus(const string & filename, long long & size, long long & modified)
+{
+	struct stat fileStatus;
+
+	if(stat(filename.c_str(), &fileStatus) != 0) return false;
+
+	size = fileStatus.st_size;
+	modified = fileStatus.st_mtime;
+
+	return true;
+};
+
+//! Starts a new index for a map file that is about to be read.
+void MapFileIndex::start(const string & filename)
+{
+	blocks.clear();
+	noSNPs = 0;
+
+	if(!getFileStatus(filename, fileSize, modifiedTime))
+	{
+		fileSize = -1;
+		modifiedTime = -1;
+	};
+};
+
+//! Reads the index of a map file, returns false if there is no index or it is out of date.
+bool MapFileIndex::read(const string & filename)
+{
+	blocks.clear();
+	noSNPs = 0;
+
+	if(!getFileStatus(filename, fileSize, modifiedTime)) return false;
+
+	ifstream readIndex(getIndexFileName(filename).c_str());
+	if(!readIndex.is_open()) return false;
+
+	string title, version, chromosome;
+	long long indexFileSize = -1, indexModifiedTime = -1;
+	size_t noBlocks = 0, filePosition, firstSNP, noBlockSNPs;
+
+	readIndex >> title >> version >> indexFileSize >> indexModifiedTime >> noBlocks;
+
+	if(!readIndex || title != "MapThinIndex" || version != "1" || indexFileSize != fileSize || indexModifiedTime != modifiedTime) return false;
+
+	for(size_t b = 0; b < noBlocks; ++b)
+	{
+		readIndex >> chromosome >> filePosition >> firstSNP >> noBlockSNPs;
+
+		if(!readIndex || firstSNP != noSNPs || (long long)filePosition >= fileSize)
+		{
+			blocks.clear();
+			noSNPs = 0;
+			return false;
+		};
+
+		blocks.push_back(IndexBlock(chromosome, filePosition, firstSNP));
+		blocks.back().noSNPs = noBlockSNPs;
+		noSNPs += noBlockSNPs;
+	};
+
+	return true;
+};
+
+//! Writes the index beside the map file, nothing is written if the map file changed while it was read or the index cannot be written.
+void MapFileIndex::write(const string & filename) const
+{
+	long long size, modified;
+
+	if(!getFileStatus(filename, size, modified) || size != fileSize || modified != modifiedTime) return;
+
+	string indexFileName = getIndexFileName(filename);
+	ofstream writeIndex(indexFileName.c_str());
+	if(!writeIndex.is_open()) return;
+
+	writeIndex << "MapThinIndex 1\n" << fileSize << " " << modifiedTime << "\n" << blocks.size() << "\n";
+
+	for(vector<IndexBlock>::const_iterator b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		writeIndex << b->chromosome << "\t" << b->filePosition << "\t" << b->firstSNP << "\t" << b->noSNPs << "\n";
+	};
+
+	writeIndex.close();
+
+	if(!writeIndex) remove(indexFileName.c_str());
+};
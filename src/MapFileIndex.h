@@ -0,0 +1,88 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __MAPFILEINDEX
+#define __MAPFILEINDEX
+
+#include <string>
+#include <vector>
+
+#include "MapFileReader.h"
+
+using namespace std;
+
+//! Class to store where one block of lines of the same chromosome is in a map file.
+struct IndexBlock
+{
+	string chromosome;
+	size_t filePosition; //of the first line of the block
+	size_t firstSNP; //number of the first SNP of the block in the file, counting from 0
+	size_t noSNPs;
+
+	IndexBlock(const string & chr, const size_t & fp, const size_t & fs) : chromosome(chr), filePosition(fp), firstSNP(fs), noSNPs(0) {};
+
+	~IndexBlock() {};
+};
+
+//! Class for an index of the chromosomes of a map file, kept in a small file beside the map file so that the lines of a
+//! chromosome can be found without reading the whole map file. The index is only used if the size and modified time of the
+//! map file are the same as when it was made.
+class MapFileIndex
+{
+private:
+	vector<IndexBlock> blocks;
+	size_t noSNPs;
+	long long fileSize;
+	long long modifiedTime;
+
+public:
+
+	MapFileIndex() : blocks(), noSNPs(0), fileSize(-1), modifiedTime(-1) {};
+
+	~MapFileIndex() {};
+
+	static string getIndexFileName(const string & filename) {return filename + ".mti";};
+	static bool getFileStatus(const string & filename, long long & size, long long & modified);
+
+	void start(const string & filename);
+	void addSNP(const FieldView & chromosome, const size_t & filePosition);
+	bool read(const string & filename);
+	void write(const string & filename) const;
+	const vector<IndexBlock> & getBlocks() const {return blocks;};
+	size_t getNoSNPs() const {return noSNPs;};
+};
+
+//! Adds the next SNP line of the map file, starting a new block if the chromosome changes.
+inline void MapFileIndex::addSNP(const FieldView & chromosome, const size_t & filePosition)
+{
+	if(blocks.empty() || chromosome != blocks.back().chromosome) blocks.push_back(IndexBlock(chromosome.str(), filePosition, noSNPs));
+
+	blocks.back().noSNPs++;
+	noSNPs++;
+};
+
+#endif
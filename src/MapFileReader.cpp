@@ -0,0 +1,597 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+#include "MapFileReader.h"
+#include "Gzip.h"
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <ostream>
+#include <iostream>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+//! Converts the field to a number in the same way as atof, but without copying it.
+double FieldView::toDouble() const
+{
+	const char * first = start;
+	const char * last = start + length;
+
+#if defined(__cpp_lib_to_chars)
+	double number = 0;
+
+	if(first != last && *first == '+')
+	{
+		++first;
+		if(first != last && *first == '-') return 0;
+	};
+
+	if(first == last) return 0;
+
+	from_chars_result result = from_chars(first, last, number);
+
+	//fall back to atof for hexadecimal numbers and numbers out of range
+	if(result.ec == errc() && !(result.ptr != last && (*result.ptr == 'x' || *result.ptr == 'X'))) return number;
+	else if(result.ec == errc::invalid_argument) return 0;
+#endif
+
+	char buffer[64];
+	size_t noChars = length < 63 ? length : 63;
+
+	memcpy(buffer, start, noChars);
+	buffer[noChars] = '\0';
+
+	return atof(buffer);
+};
+
+//! Converts a base pair position, whole numbers are read as integers and anything else as atof would.
+double FieldView::toPosition() const
+{
+	const char * c = start;
+	const char * last = start + length;
+	bool negative = false;
+	uint64_t number = 0;
+
+	if(c != last && (*c == '-' || *c == '+'))
+	{
+		negative = *c == '-';
+		++c;
+	};
+
+	if(c == last || last - c > 18) return toDouble();
+
+#if defined(__cpp_lib_to_chars)
+	from_chars_result result = from_chars(c, last, number);
+	if(result.ec != errc() || result.ptr != last) return toDouble();
+#else
+	for(; c != last; ++c)
+	{
+		if(*c < '0' || *c > '9') return toDouble();
+		number = number*10 + (*c - '0');
+	};
+#endif
+
+	if(negative) return -(double)number;
+
+	return (double)number;
+};
+
+//! Returns whether a file name ends with .vcf, ignoring any .gz or .bgz ending.
+bool isVCFFileName(const string & filename)
+{
+	string uncompressedName = removeCompressedExtension(filename);
+	size_t length = uncompressedName.length();
+
+	if(length < 4) return false;
+
+	string fileExtension = uncompressedName.substr(length-4);
+
+	return fileExtension == ".vcf" || fileExtension == ".VCF";
+};
+
+//! Writes the characters of a field.
+ostream & operator<<(ostream & os, const FieldView & fv)
+{
+	return os.write(fv.start, fv.length);
+};
+
+//! Opens a map file, a regular file is memory mapped, otherwise it is read into memory. Compressed files
+//! are decompressed using the threads of the thread pool, if given. VCF files have the CHROM, POS and ID columns read, and
+//! are decompressed a piece at a time if streamed, otherwise all at once so that any line may be read.
+void MapFileReader::open(const string & filename, const bool & bm, const bool & vc, ThreadPool * threadPool, const bool & stream)
+{
+	close();
+	bim = bm;
+	vcf = vc;
+
+#ifdef _WIN32
+	int fileDescriptor = _open(filename.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	int fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+#endif
+
+	if(fileDescriptor < 0) return;
+
+#ifndef _WIN32
+	struct stat fileStatus;
+
+	if(fstat(fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && fileStatus.st_size > 0)
+	{
+		void * mappedData = mmap(0, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+		if(mappedData != MAP_FAILED)
+		{
+			madvise(mappedData, fileStatus.st_size, MADV_SEQUENTIAL);
+			data = (const char *)mappedData;
+			size = fileStatus.st_size;
+			mapped = true;
+			fileOpen = true;
+			scanner = MapLineScanner(data, size, bim, vcf, 0);
+			::close(fileDescriptor);
+			decompress(threadPool, stream);
+			return;
+		};
+	};
+#endif
+
+	readFile(fileDescriptor);
+
+#ifdef _WIN32
+	_close(fileDescriptor);
+#else
+	::close(fileDescriptor);
+#endif
+
+	decompress(threadPool, stream);
+};
+
+//! Replaces the file data with the decompressed data if the file is compressed, the file is closed if it cannot be decompressed.
+//! VCF files, which may be very large, are instead decompressed a piece at a time as they are read if they are streamed.
+void MapFileReader::decompress(ThreadPool * threadPool, const bool & stream)
+{
+	if(!fileOpen || !isGzipData(data, size)) return;
+
+	if(!gzipSupported)
+	{
+		cerr << "This version of MapThin was compiled without zlib and cannot read compressed files!\n";
+		close();
+		return;
+	};
+
+	compressed = true;
+
+	if(vcf && stream)
+	{
+		gzipStream = new GzipStream(data, size, threadPool);
+		windowCapacity = 64*bgzfMaxBlockSize; //about 4 MB
+		window = (char *)malloc(windowCapacity);
+		if(window == 0) close();
+		else scanner = MapLineScanner(window, 0, bim, vcf, 0);
+		return;
+	};
+
+	char * decompressed = 0;
+	size_t decompressedSize = 0;
+	bool ok = decompressGzip(data, size, decompressed, decompressedSize, threadPool);
+
+	close();
+
+	if(!ok) return;
+
+	compressed = true;
+	data = decompressed;
+	size = decompressedSize;
+	mapped = false;
+	fileOpen = true;
+	scanner = MapLineScanner(data, size, bim, vcf, 0);
+};
+
+//! Reads the whole file into a buffer, used for pipes and other files that cannot be mapped.
+void MapFileReader::readFile(const int & fileDescriptor)
+{
+	size_t capacity = 1 << 20;
+	char * buffer = (char *)malloc(capacity);
+	long noRead;
+
+	size = 0;
+
+	if(buffer == 0) return;
+
+	while(true)
+	{
+		if(size == capacity)
+		{
+			char * biggerBuffer = (char *)realloc(buffer, capacity*2);
+			if(biggerBuffer == 0)
+			{
+				free(buffer);
+				size = 0;
+				return;
+			};
+			buffer = biggerBuffer;
+			capacity *= 2;
+		};
+
+#ifdef _WIN32
+		noRead = _read(fileDescriptor, buffer + size, (unsigned int)(capacity - size));
+#else
+		noRead = ::read(fileDescriptor, buffer + size, capacity - size);
+#endif
+
+		if(noRead <= 0) break;
+		size += noRead;
+	};
+
+	if(noRead < 0)
+	{
+		free(buffer);
+		size = 0;
+		return;
+	};
+
+	data = buffer;
+	mapped = false;
+	fileOpen = true;
+	scanner = MapLineScanner(data, size, bim, vcf, 0);
+};
+
+//! Decompresses more of the data after the part of the window not yet read, returns false at the end of the data. The scanner
+//! is given the window up to the last newline, so that it only sees whole lines until the end of the data.
+bool MapFileReader::readMore()
+{
+	if(streamEnded || streamFailed) return false;
+
+	size_t noUsed = scanner.getPosition();
+
+	memmove(window, window + noUsed, windowSize - noUsed);
+	windowSize -= noUsed;
+	windowPosition += noUsed;
+
+	size_t noRead;
+
+	while(true)
+	{
+		//make room for at least one more BGZF block, lines may be longer than the window
+		if(windowCapacity - windowSize < bgzfMaxBlockSize)
+		{
+			char * biggerWindow = (char *)realloc(window, windowCapacity*2);
+			if(biggerWindow == 0)
+			{
+				streamFailed = true;
+				return false;
+			};
+			window = biggerWindow;
+			windowCapacity *= 2;
+		};
+
+		if(!gzipStream->read(window + windowSize, windowCapacity - windowSize, noRead))
+		{
+			streamFailed = true;
+			return false;
+		};
+
+		if(noRead == 0)
+		{
+			streamEnded = true;
+			scanner = MapLineScanner(window, windowSize, bim, vcf, 0);
+			return windowSize > 0;
+		};
+
+		size_t scanSize = windowSize + noRead;
+		while(scanSize > windowSize && window[scanSize - 1] != '\n') --scanSize;
+
+		windowSize += noRead;
+
+		if(scanSize > 0 && window[scanSize - 1] == '\n')
+		{
+			scanner = MapLineScanner(window, scanSize, bim, vcf, 0);
+			return true;
+		};
+	};
+};
+
+//! Reads the next line when the scanner has reached the end of the window, decompressing more data.
+bool MapFileReader::readNextLine(MapLine & aLine)
+{
+	while(readMore())
+	{
+		if(scanner.readLine(aLine)) return true;
+	};
+
+	return false;
+};
+
+//! Goes back to the first line of the file.
+void MapFileReader::rewind()
+{
+	if(gzipStream != 0)
+	{
+		gzipStream->rewind();
+		windowSize = 0;
+		windowPosition = 0;
+		streamEnded = false;
+		streamFailed = false;
+		scanner = MapLineScanner(window, 0, bim, vcf, 0);
+	}
+	else scanner.setPosition(0);
+};
+
+//! Closes the map file, any fields read from it are no longer valid.
+void MapFileReader::close()
+{
+	if(fileOpen)
+	{
+#ifndef _WIN32
+		if(mapped) munmap((void *)data, size);
+		else
+#endif
+			free((void *)data);
+	};
+
+	delete gzipStream;
+	free(window);
+
+	data = 0;
+	size = 0;
+	fileOpen = false;
+	mapped = false;
+	scanner = MapLineScanner();
+	gzipStream = 0;
+	window = 0;
+	windowCapacity = 0;
+	windowSize = 0;
+	windowPosition = 0;
+	streamEnded = false;
+	streamFailed = false;
+	compressed = false;
+};
+
+//! Returns whether a character separates fields, that is ' ', '\t', '\n', '\v', '\f' or '\r'.
+static inline bool isSeparator(const char & c)
+{
+	return c == ' ' || (unsigned char)(c - 9) <= 4;
+};
+
+//! Sets a bit for each white space character and each newline in the next 64 characters.
+static inline void getSeparatorMasks(const char * c, uint64_t & separators, uint64_t & newlines)
+{
+#if defined(__AVX2__)
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i tab = _mm256_set1_epi8(9);
+	const __m256i four = _mm256_set1_epi8(4);
+
+	separators = 0;
+	newlines = 0;
+
+	for(unsigned int block = 0; block < 2; ++block)
+	{
+		__m256i chars = _mm256_loadu_si256((const __m256i *)(c + 32*block));
+		__m256i fromTab = _mm256_sub_epi8(chars, tab);
+		__m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(fromTab, four), fromTab);
+		__m256i isSpace = _mm256_cmpeq_epi8(chars, space);
+
+		separators |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(isSpace, isControl)) << (32*block);
+		newlines |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, newline)) << (32*block);
+	};
+#elif defined(__SSE2__)
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i tab = _mm_set1_epi8(9);
+	const __m128i four = _mm_set1_epi8(4);
+
+	separators = 0;
+	newlines = 0;
+
+	for(unsigned int block = 0; block < 4; ++block)
+	{
+		__m128i chars = _mm_loadu_si128((const __m128i *)(c + 16*block));
+		__m128i fromTab = _mm_sub_epi8(chars, tab);
+		__m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(fromTab, four), fromTab);
+		__m128i isSpace = _mm_cmpeq_epi8(chars, space);
+
+		separators |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_or_si128(isSpace, isControl)) << (16*block);
+		newlines |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline)) << (16*block);
+	};
+#else
+	separators = 0;
+	newlines = 0;
+
+	for(unsigned int i = 0; i < 64; ++i)
+	{
+		if(isSeparator(c[i])) separators |= (uint64_t)1 << i;
+		if(c[i] == '\n') newlines |= (uint64_t)1 << i;
+	};
+#endif
+};
+
+//! Sets the masks for the last characters of the data, positions past the end are treated as white space.
+static inline void getSeparatorMasksTail(const char * c, const size_t & noChars, uint64_t & separators, uint64_t & newlines)
+{
+	separators = ~(uint64_t)0 << noChars;
+	newlines = 0;
+
+	for(size_t i = 0; i < noChars; ++i)
+	{
+		if(isSeparator(c[i])) separators |= (uint64_t)1 << i;
+		if(c[i] == '\n') newlines |= (uint64_t)1 << i;
+	};
+};
+
+//! Returns the position of the lowest set bit.
+static inline unsigned int lowestBit(const uint64_t & bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#else
+	unsigned int bit = 0;
+	while(!(bits & ((uint64_t)1 << bit))) ++bit;
+	return bit;
+#endif
+};
+
+//! Sets the white space and newline masks for the block of 64 characters starting at blockStart.
+void MapLineScanner::setMasks(const size_t & blockStart)
+{
+	if(size - blockStart >= 64) getSeparatorMasks(data + blockStart, separatorMask, newlineMask);
+	else getSeparatorMasksTail(data + blockStart, size - blockStart, separatorMask, newlineMask);
+
+	maskPosition = blockStart;
+};
+
+//! Reads the fields of the next non-blank line, returns false at the end of the file. The fields of VCF header lines are left empty.
+bool MapLineScanner::readLine(MapLine & aLine)
+{
+	FieldView * fields[6] = {&aLine.chromosome, &aLine.snpIdentifier, &aLine.geneticDistance, &aLine.basePairPosition, &aLine.alleleName1, &aLine.alleleName2};
+	unsigned int noColumns = 4;
+	if(bim) noColumns = 6;
+	else if(vcf)
+	{
+		fields[1] = &aLine.basePairPosition;
+		fields[2] = &aLine.snpIdentifier;
+		fields[3] = &aLine.geneticDistance;
+		noColumns = 3;
+	};
+
+	size_t lineStart = position;
+	size_t blockStart = position & ~(size_t)63;
+	unsigned int offset = position - blockStart;
+	const char * fieldStart = 0;
+	unsigned int noFields = 0;
+	bool skipToLineEnd = false;
+	bool header = false;
+	uint64_t bits, newlineBits;
+
+	//scan blocks of 64 characters using masks of the white space and newlines, the masks are reused by the following lines
+	while(blockStart < size)
+	{
+		if(blockStart != maskPosition) setMasks(blockStart);
+
+		while(offset < 64)
+		{
+			newlineBits = newlineMask & (~(uint64_t)0 << offset);
+
+			//ignore any further columns
+			if(skipToLineEnd)
+			{
+				if(newlineBits == 0) break;
+
+				position = blockStart + lowestBit(newlineBits) + 1;
+				for(unsigned int f = noFields; f < 6; ++f) *fields[f] = FieldView();
+				aLine.line = FieldView(data + lineStart, position - lineStart);
+				aLine.header = header;
+				return true;
+			};
+
+			if(fieldStart == 0)
+			{
+				//find the start of the next field or the end of the line
+				bits = ~separatorMask & (~(uint64_t)0 << offset);
+
+				if(newlineBits != 0 && (bits == 0 || lowestBit(newlineBits) < lowestBit(bits)))
+				{
+					offset = lowestBit(newlineBits) + 1;
+
+					if(noFields > 0)
+					{
+						position = blockStart + offset;
+						for(unsigned int f = noFields; f < 6; ++f) *fields[f] = FieldView();
+						aLine.line = FieldView(data + lineStart, position - lineStart);
+						aLine.header = false;
+						return true;
+					};
+
+					//skip blank lines
+					lineStart = blockStart + offset;
+					continue;
+				};
+
+				if(bits == 0) break;
+
+				offset = lowestBit(bits);
+				fieldStart = data + blockStart + offset;
+
+				//the rest of a VCF header line is not split into fields
+				if(vcf && noFields == 0 && *fieldStart == '#')
+				{
+					header = true;
+					skipToLineEnd = true;
+					fieldStart = 0;
+					continue;
+				};
+			};
+
+			//find the end of the current field
+			bits = separatorMask & (~(uint64_t)0 << offset);
+			if(bits == 0) break;
+
+			offset = lowestBit(bits);
+			*fields[noFields++] = FieldView(fieldStart, (data + blockStart + offset) - fieldStart);
+			fieldStart = 0;
+
+			if(noFields == noColumns) skipToLineEnd = true;
+		};
+
+		blockStart += 64;
+		offset = 0;
+	};
+
+	position = size;
+
+	//the last line does not end with a newline
+	if(fieldStart != 0) *fields[noFields++] = FieldView(fieldStart, (data + size) - fieldStart);
+
+	if(noFields == 0 && !header) return false;
+
+	for(unsigned int f = noFields; f < 6; ++f) *fields[f] = FieldView();
+	aLine.line = FieldView(data + lineStart, size - lineStart);
+	aLine.header = header;
+
+	return true;
+};
@@ -0,0 +1,156 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __MAPFILEREADER
+#define __MAPFILEREADER
+
+#include <string>
+#include <cstring>
+#include <ostream>
+#include <stdint.h>
+
+#include "ThreadPool.h"
+#include "Gzip.h"
+
+using namespace std;
+
+//! Class to view one field of a line in a map file, the characters are not copied
+struct FieldView
+{
+	const char * start;
+	size_t length;
+
+	FieldView() : start(""), length(0) {};
+	FieldView(const char * st, const size_t & len) : start(st), length(len) {};
+
+	~FieldView() {};
+
+	string str() const {return string(start, length);};
+	double toDouble() const;
+	double toPosition() const;
+
+	bool operator==(const FieldView & fv) const {return length == fv.length && memcmp(start, fv.start, length) == 0;};
+	bool operator!=(const FieldView & fv) const {return !(*this == fv);};
+	bool operator==(const string & s) const {return length == s.length() && memcmp(start, s.data(), length) == 0;};
+	bool operator!=(const string & s) const {return !(*this == s);};
+};
+
+ostream & operator<<(ostream & os, const FieldView & fv);
+
+bool isVCFFileName(const string & filename);
+
+//! Class to store the fields of one line of a map file, the fields point into the file data
+struct MapLine
+{
+	FieldView chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2;
+	FieldView line; //all of the line, including the newline if there is one
+	bool header; //a VCF header line, starting with #, which has no fields
+};
+
+//! Class for splitting map file data into lines and fields, several scanners may read the same data at once.
+class MapLineScanner
+{
+private:
+	const char * data;
+	size_t size;
+	size_t position; //start of the next line to read
+	size_t maskPosition; //start of the block of characters that the masks are for
+	uint64_t separatorMask; //bit set for each white space character in the block
+	uint64_t newlineMask; //bit set for each newline in the block
+	bool bim;
+	bool vcf; //the columns read are CHROM, POS and ID
+
+	void setMasks(const size_t & blockStart);
+
+public:
+
+	MapLineScanner() : data(0), size(0), position(0), maskPosition((size_t)-1), separatorMask(0), newlineMask(0), bim(false), vcf(false) {};
+	MapLineScanner(const char * dt, const size_t & sz, const bool & bm, const bool & vc, const size_t & pos) : data(dt), size(sz), position(pos), maskPosition((size_t)-1), separatorMask(0), newlineMask(0), bim(bm), vcf(vc) {};
+
+	~MapLineScanner() {};
+
+	bool readLine(MapLine & aLine);
+	size_t getPosition() const {return position;};
+	void setPosition(const size_t & pos) {position = pos;};
+};
+
+//! Class for reading the lines of a map file, the file is memory mapped or read in once if it cannot be mapped.
+//! Gzip and BGZF files are decompressed into memory when opened, except for VCF files which are decompressed a piece at a time
+//! as the lines are read unless they are opened to be read in any order, in which case the fields of a line are only valid until the next line is read.
+class MapFileReader
+{
+private:
+	const char * data; //the contents of the file
+	size_t size;
+	bool fileOpen;
+	bool mapped; //data is memory mapped rather than read into a buffer
+	bool bim;
+	bool vcf;
+	MapLineScanner scanner;
+	GzipStream * gzipStream; //used if the data is decompressed a piece at a time
+	char * window; //the decompressed data being read
+	size_t windowCapacity;
+	size_t windowSize;
+	size_t windowPosition; //of the start of the window in the decompressed data
+	bool streamEnded;
+	bool streamFailed;
+	bool compressed; //the file was decompressed when opened
+
+	void readFile(const int & fileDescriptor);
+	void decompress(ThreadPool * threadPool, const bool & stream);
+	bool readMore();
+	bool readNextLine(MapLine & aLine);
+
+public:
+
+	MapFileReader() : data(0), size(0), fileOpen(false), mapped(false), bim(false), vcf(false), scanner(), gzipStream(0), window(0), windowCapacity(0),
+		windowSize(0), windowPosition(0), streamEnded(false), streamFailed(false), compressed(false) {};
+
+	~MapFileReader()
+	{
+		close();
+	};
+
+	void open(const string & filename, const bool & bm, const bool & vc, ThreadPool * threadPool = 0, const bool & stream = true);
+	void close();
+	bool isOpen() const {return fileOpen;};
+	bool isStreaming() const {return gzipStream != 0;};
+	bool isCompressed() const {return compressed;};
+	bool isBim() const {return bim;};
+	bool isVCF() const {return vcf;};
+	bool hasFailed() const {return streamFailed;};
+	bool readLine(MapLine & aLine) {return scanner.readLine(aLine) || (gzipStream != 0 && readNextLine(aLine));};
+	void rewind();
+	void setThreadPool(ThreadPool * threadPool) {if(gzipStream != 0) gzipStream->setThreadPool(threadPool);}; //for the rest of a compressed VCF file
+	size_t getPosition() const {return windowPosition + scanner.getPosition();};
+	void setPosition(const size_t & position) {scanner.setPosition(position);}; //not when streaming
+	size_t getSize() const {return size;};
+	const char * getData() const {return data;};
+	MapLineScanner getScanner(const size_t & position) const {return MapLineScanner(data, size, bim, vcf, position);};
+};
+
+#endif
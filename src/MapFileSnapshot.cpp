@@ -0,0 +1,211 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "MapFileSnapshot.h"
+#include "MapFileIndex.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+static const char snapshotTitle[8] = {'M', 'a', 'p', 'T', 'h', 'i', 'n', 'S'};
+static const uint64_t snapshotVersion = 1;
+static const uint64_t snapshotByteOrder = 0x0102030405060708ULL;
+
+//! Parts of the map file hashed to check that the snapshot is for the same map file, spread evenly from the start to the end.
+static const size_t noHashedParts = 64;
+static const size_t hashedPartSize = 4096;
+
+//! Returns the flags of a snapshot for the kind of map file and the positions kept.
+uint64_t MapFileSnapshot::getFlags(const bool & bim, const bool & vcf, const bool & useBasePairPosition)
+{
+	return (bim ? 1 : 0) | (vcf ? 2 : 0) | (useBasePairPosition ? 4 : 0);
+};
+
+//! Returns a hash of parts of the map file data spread through it, or all of it if it is small, so that a map file changed
+//! without changing its size or modified time is seen without reading all of it.
+uint64_t MapFileSnapshot::getContentHash(const char * data, const size_t & size)
+{
+	const uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+	uint64_t hash = size*multiplier;
+	size_t partStart, partEnd;
+
+	for(size_t p = 0; p < noHashedParts; ++p)
+	{
+		if(size <= noHashedParts*hashedPartSize)
+		{
+			partStart = size*p/noHashedParts;
+			partEnd = size*(p + 1)/noHashedParts;
+		}
+		else
+		{
+			partStart = (size - hashedPartSize)/(noHashedParts - 1)*p;
+			partEnd = partStart + hashedPartSize;
+		};
+
+		for(size_t i = partStart; i < partEnd; ++i)
+		{
+			hash = (hash ^ (unsigned char)data[i])*multiplier;
+			hash ^= hash >> 29;
+		};
+	};
+
+	return hash;
+};
+
+//! Reads the snapshot of a map file that has been opened, returns false if there is no snapshot or it is out of date.
+bool MapFileSnapshot::read(const string & filename, const MapFileReader & readMap, const bool & useBasePairPosition)
+{
+	header = 0;
+
+	long long fileSize, modifiedTime;
+	if(!MapFileIndex::getFileStatus(filename, fileSize, modifiedTime) || fileSize != (long long)readMap.getSize()) return false;
+
+	readSnapshot.open(getSnapshotFileName(filename), false, false);
+	if(!readSnapshot.isOpen() || readSnapshot.isCompressed() || readSnapshot.getSize() < sizeof(SnapshotHeader)) return false;
+
+	const char * data = readSnapshot.getData();
+	const SnapshotHeader * snapshotHeader = (const SnapshotHeader *)data;
+
+	if(memcmp(snapshotHeader->title, snapshotTitle, 8) != 0 || snapshotHeader->version != snapshotVersion || snapshotHeader->byteOrder != snapshotByteOrder
+		|| snapshotHeader->fileSize != fileSize || snapshotHeader->modifiedTime != modifiedTime
+		|| snapshotHeader->flags != getFlags(readMap.isBim(), readMap.isVCF(), useBasePairPosition)) return false;
+
+	//check the snapshot is all there before using its arrays
+	uint64_t noSNPs = snapshotHeader->noSNPs;
+	uint64_t noBlocks = snapshotHeader->noBlocks;
+	uint64_t namesSize = snapshotHeader->namesSize;
+	size_t maxSize = readSnapshot.getSize();
+
+	if(noBlocks > maxSize/sizeof(SnapshotBlock) || namesSize > maxSize || noSNPs > maxSize/16 || namesSize % 8 != 0
+		|| sizeof(SnapshotHeader) + noBlocks*sizeof(SnapshotBlock) + namesSize + noSNPs*16 != maxSize) return false;
+
+	if(snapshotHeader->contentHash != getContentHash(readMap.getData(), readMap.getSize())) return false;
+
+	const SnapshotBlock * snapshotBlocks = (const SnapshotBlock *)(data + sizeof(SnapshotHeader));
+	uint64_t noBlockSNPs = 0;
+
+	for(uint64_t b = 0; b < noBlocks; ++b)
+	{
+		const SnapshotBlock & block = snapshotBlocks[b];
+
+		if(block.firstSNP != noBlockSNPs || block.noSNPs == 0 || block.nameStart > namesSize || block.nameLength > namesSize - block.nameStart
+			|| block.filePosition >= (uint64_t)fileSize) return false;
+
+		noBlockSNPs += block.noSNPs;
+	};
+
+	if(noBlockSNPs != noSNPs) return false;
+
+	header = snapshotHeader;
+	blocks = snapshotBlocks;
+	names = (const char *)(blocks + noBlocks);
+	positions = (const double *)(names + namesSize);
+	linePositions = (const uint64_t *)(positions + noSNPs);
+
+	for(uint64_t i = 0; i < noSNPs; ++i)
+	{
+		if(linePositions[i] >= (uint64_t)fileSize)
+		{
+			header = 0;
+			return false;
+		};
+	};
+
+	return true;
+};
+
+//! Writes the snapshot of the SNPs read from a map file beside it. The chromosomes are blocks of the SNPs given, which start at the
+//! first SNP of the first block. The snapshot is written to a temporary file that replaces any old snapshot when it is complete,
+//! and nothing is written if the map file changed while it was read or the snapshot cannot be written.
+void MapFileSnapshot::write(const string & filename, const MapFileReader & readMap, const bool & useBasePairPosition, const Chromosome * chromosomes,
+	const size_t & noChromosomes, const double * snpPositions, const size_t * snpLinePositions, const size_t & noSNPs)
+{
+	long long fileSize, modifiedTime;
+	if(!MapFileIndex::getFileStatus(filename, fileSize, modifiedTime) || fileSize != (long long)readMap.getSize()) return;
+
+	SnapshotHeader snapshotHeader;
+	memcpy(snapshotHeader.title, snapshotTitle, 8);
+	snapshotHeader.version = snapshotVersion;
+	snapshotHeader.byteOrder = snapshotByteOrder;
+	snapshotHeader.fileSize = fileSize;
+	snapshotHeader.modifiedTime = modifiedTime;
+	snapshotHeader.contentHash = getContentHash(readMap.getData(), readMap.getSize());
+	snapshotHeader.flags = getFlags(readMap.isBim(), readMap.isVCF(), useBasePairPosition);
+	snapshotHeader.noSNPs = noSNPs;
+	snapshotHeader.noBlocks = noChromosomes;
+
+	vector<SnapshotBlock> snapshotBlocks(noChromosomes);
+	string chromosomeNames;
+
+	for(size_t c = 0; c < noChromosomes; ++c)
+	{
+		snapshotBlocks[c].nameStart = chromosomeNames.length();
+		snapshotBlocks[c].nameLength = chromosomes[c].name.length();
+		snapshotBlocks[c].firstSNP = chromosomes[c].firstSNP - chromosomes[0].firstSNP;
+		snapshotBlocks[c].noSNPs = chromosomes[c].noSNPs;
+		snapshotBlocks[c].filePosition = chromosomes[c].filePosition;
+		chromosomeNames += chromosomes[c].name;
+	};
+
+	//the arrays after the names start at a multiple of 8 bytes
+	chromosomeNames.resize((chromosomeNames.length() + 7)/8*8, '\0');
+	snapshotHeader.namesSize = chromosomeNames.length();
+
+	string snapshotFileName = getSnapshotFileName(filename);
+	string partFileName = snapshotFileName + ".part";
+	ofstream writeSnapshot(partFileName.c_str(), ios::out | ios::binary);
+	if(!writeSnapshot.is_open()) return;
+
+	writeSnapshot.write((const char *)&snapshotHeader, sizeof(SnapshotHeader));
+	if(noChromosomes != 0) writeSnapshot.write((const char *)&snapshotBlocks[0], noChromosomes*sizeof(SnapshotBlock));
+	writeSnapshot.write(chromosomeNames.data(), chromosomeNames.length());
+	writeSnapshot.write((const char *)snpPositions, noSNPs*sizeof(double));
+
+	//the line positions are written as 64 bit numbers whatever the size of size_t
+	vector<uint64_t> buffer;
+	for(size_t start = 0; start < noSNPs; start += 65536)
+	{
+		buffer.assign(snpLinePositions + start, snpLinePositions + min(start + 65536, noSNPs));
+		writeSnapshot.write((const char *)&buffer[0], buffer.size()*sizeof(uint64_t));
+	};
+
+	writeSnapshot.close();
+
+	if(!writeSnapshot)
+	{
+		remove(partFileName.c_str());
+		return;
+	};
+
+	remove(snapshotFileName.c_str());
+	if(rename(partFileName.c_str(), snapshotFileName.c_str()) != 0) remove(partFileName.c_str());
+};
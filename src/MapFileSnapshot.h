@@ -0,0 +1,101 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __MAPFILESNAPSHOT
+#define __MAPFILESNAPSHOT
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "MapFileReader.h"
+#include "SNPThinner.h"
+
+using namespace std;
+
+//! Class to store the start of a snapshot file, used straight from the file so it has no constructor, which is followed by the blocks, the chromosome names, the positions and the line positions.
+struct SnapshotHeader
+{
+	char title[8];
+	uint64_t version;
+	uint64_t byteOrder; //to check the snapshot was written on a machine with the same byte order
+	int64_t fileSize; //of the map file
+	int64_t modifiedTime;
+	uint64_t contentHash; //of parts of the map file spread through it
+	uint64_t flags; //the kind of map file and the positions kept
+	uint64_t noSNPs;
+	uint64_t noBlocks;
+	uint64_t namesSize; //bytes of the chromosome names, rounded up to a multiple of 8
+};
+
+//! Class to store one block of SNPs of the same chromosome in a snapshot file.
+struct SnapshotBlock
+{
+	uint64_t nameStart, nameLength; //in the chromosome names
+	uint64_t firstSNP;
+	uint64_t noSNPs;
+	uint64_t filePosition; //of the first line of the block
+};
+
+//! Class for a snapshot of the SNPs read from a map file, kept in a binary file beside the map file so that the map file does not
+//! need to be parsed again. It has the blocks of chromosomes as they were read, and the position and line position of every SNP
+//! in arrays that are used straight from the memory mapped snapshot. The snapshot is only used if the size, modified time and a
+//! hash of parts of the map file are the same as when it was made, and it was made with the same kind of positions.
+class MapFileSnapshot
+{
+private:
+	MapFileReader readSnapshot;
+	const SnapshotHeader * header;
+	const SnapshotBlock * blocks;
+	const char * names;
+	const double * positions;
+	const uint64_t * linePositions;
+
+	static uint64_t getFlags(const bool & bim, const bool & vcf, const bool & useBasePairPosition);
+
+public:
+
+	MapFileSnapshot() : readSnapshot(), header(0), blocks(0), names(0), positions(0), linePositions(0) {};
+
+	~MapFileSnapshot() {};
+
+	static string getSnapshotFileName(const string & filename) {return filename + ".mts";};
+	static uint64_t getContentHash(const char * data, const size_t & size);
+
+	bool read(const string & filename, const MapFileReader & readMap, const bool & useBasePairPosition);
+	static void write(const string & filename, const MapFileReader & readMap, const bool & useBasePairPosition, const Chromosome * chromosomes,
+		const size_t & noChromosomes, const double * snpPositions, const size_t * snpLinePositions, const size_t & noSNPs);
+	size_t getNoBlocks() const {return header->noBlocks;};
+	const SnapshotBlock & getBlock(const size_t & b) const {return blocks[b];};
+	string getBlockName(const size_t & b) const {return string(names + blocks[b].nameStart, blocks[b].nameLength);};
+	size_t getNoSNPs() const {return header->noSNPs;};
+	size_t getSnapshotSize() const {return readSnapshot.getSize();};
+	const double * getPositions() const {return positions;};
+	const uint64_t * getLinePositions() const {return linePositions;};
+};
+
+#endif
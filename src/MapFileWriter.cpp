@@ -0,0 +1,239 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "MapFileWriter.h"
+#include "Gzip.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const size_t bufferCapacity = 64*bgzfBlockDataSize; //bytes copied before writing, about 4 MB
+static const size_t directWriteLength = 64*1024; //runs at least this long are written straight from the map file data
+
+//! Returns a file name with a tag before the file extension, e.g. out.map with tag t2 is out.t2.map, keeping any .gz or .bgz ending.
+string getTaggedFileName(const string & filename, const string & tag)
+{
+	string uncompressedName = removeCompressedExtension(filename);
+	string compressedExtension = filename.substr(uncompressedName.length());
+	size_t dot = uncompressedName.find_last_of('.');
+	size_t slash = uncompressedName.find_last_of("/\\");
+
+	if(dot == string::npos || (slash != string::npos && dot < slash)) return uncompressedName + "." + tag + compressedExtension;
+
+	return uncompressedName.substr(0, dot) + "." + tag + uncompressedName.substr(dot) + compressedExtension;
+};
+
+//! Returns a file name without its directory or file extension, and without any .gz or .bgz ending, e.g. data/chr1.bim.gz is chr1.
+string getFileNameStem(const string & filename)
+{
+	string stem = removeCompressedExtension(filename);
+	size_t slash = stem.find_last_of("/\\");
+	if(slash != string::npos) stem = stem.substr(slash + 1);
+
+	size_t dot = stem.find_last_of('.');
+	if(dot != string::npos && dot > 0) stem = stem.substr(0, dot);
+
+	return stem;
+};
+
+//! Adds a range of bytes, joining it to the last range if it follows on from it.
+void LineRanges::write(const FieldView & bytes)
+{
+	if(!ranges.empty() && ranges.back().start + ranges.back().length == bytes.start) ranges.back().length += bytes.length;
+	else ranges.push_back(bytes);
+};
+
+//! Opens a file for writing, replacing any file with the same name. The file is compressed as BGZF if cmp is set.
+void MapFileWriter::open(const string & filename, const bool & cmp, ThreadPool * tp)
+{
+	close();
+
+	compress = cmp;
+	threadPool = tp;
+
+#ifdef _WIN32
+	fileDescriptor = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	fileDescriptor = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif
+
+	if(fileDescriptor < 0) return;
+
+	buffer = (char *)malloc(bufferCapacity);
+	bufferSize = 0;
+	pendingStart = 0;
+	pendingLength = 0;
+};
+
+//! Writes anything not yet written and closes the file.
+void MapFileWriter::close()
+{
+	if(fileDescriptor < 0) return;
+
+	writePending();
+	flush();
+
+	if(compress)
+	{
+		const char * endOfFile;
+		size_t endOfFileSize;
+		getBGZFEndOfFile(endOfFile, endOfFileSize);
+		writeAll(endOfFile, endOfFileSize);
+	};
+
+#ifdef _WIN32
+	_close(fileDescriptor);
+#else
+	::close(fileDescriptor);
+#endif
+
+	free(buffer);
+	buffer = 0;
+	fileDescriptor = -1;
+	compressedBlocks.clear();
+};
+
+//! Adds bytes to the file, the bytes must not change until they are written or the file is closed unless the ranges are copied.
+void MapFileWriter::write(const FieldView & bytes)
+{
+	if(fileDescriptor < 0 || bytes.length == 0) return;
+
+	if(pendingLength != 0 && pendingStart + pendingLength == bytes.start)
+	{
+		pendingLength += bytes.length;
+		return;
+	};
+
+	writePending();
+
+	pendingStart = bytes.start;
+	pendingLength = bytes.length;
+
+	if(copyRanges) writePending();
+};
+
+//! Adds all of the kept ranges to the file.
+void MapFileWriter::write(const LineRanges & lineRanges)
+{
+	for(vector<FieldView>::const_iterator r = lineRanges.getRanges().begin(); r != lineRanges.getRanges().end(); ++r) write(*r);
+};
+
+//! Copies the pending range to the buffer, or writes it directly if it is long.
+void MapFileWriter::writePending()
+{
+	if(pendingLength == 0) return;
+
+	if(buffer == 0 || (!compress && pendingLength >= directWriteLength))
+	{
+		flush();
+		writeAll(pendingStart, pendingLength);
+	}
+	else
+	{
+		//compressed data always goes through the buffer
+		size_t noToCopy;
+
+		while(pendingLength > 0)
+		{
+			if(bufferSize == bufferCapacity) flush();
+
+			noToCopy = bufferCapacity - bufferSize;
+			if(noToCopy > pendingLength) noToCopy = pendingLength;
+
+			memcpy(buffer + bufferSize, pendingStart, noToCopy);
+			bufferSize += noToCopy;
+			pendingStart += noToCopy;
+			pendingLength -= noToCopy;
+		};
+	};
+
+	pendingLength = 0;
+};
+
+//! Writes the buffer to the file.
+void MapFileWriter::flush()
+{
+	if(compress) compressBuffer();
+	else writeAll(buffer, bufferSize);
+
+	bufferSize = 0;
+};
+
+//! Writes the buffer to the file as BGZF blocks, the blocks are compressed in parallel.
+void MapFileWriter::compressBuffer()
+{
+	size_t noBlocks = (bufferSize + bgzfBlockDataSize - 1)/bgzfBlockDataSize;
+	vector<size_t> blockSizes(noBlocks);
+
+	if(compressedBlocks.size() < noBlocks) compressedBlocks.resize(noBlocks, vector<char>(bgzfMaxBlockSize));
+
+	function<void(size_t)> compressBlock = [&](size_t b)
+	{
+		size_t start = b*bgzfBlockDataSize;
+		size_t length = bufferSize - start;
+		if(length > bgzfBlockDataSize) length = bgzfBlockDataSize;
+
+		blockSizes[b] = compressBGZFBlock(buffer + start, length, &compressedBlocks[b][0]);
+	};
+
+	if(threadPool != 0) threadPool->run(noBlocks, compressBlock);
+	else for(size_t b = 0; b < noBlocks; ++b) compressBlock(b);
+
+	for(size_t b = 0; b < noBlocks; ++b) writeAll(&compressedBlocks[b][0], blockSizes[b]);
+};
+
+//! Writes bytes to the file, continuing after partial writes.
+void MapFileWriter::writeAll(const char * bytes, size_t length)
+{
+	while(length > 0)
+	{
+#ifdef _WIN32
+		int noWritten = _write(fileDescriptor, bytes, length > 0x40000000 ? 0x40000000 : (unsigned int)length);
+#else
+		ssize_t noWritten = ::write(fileDescriptor, bytes, length);
+#endif
+
+		if(noWritten < 0 && errno == EINTR) continue;
+		if(noWritten <= 0) return;
+
+		bytes += noWritten;
+		length -= noWritten;
+	};
+};
@@ -0,0 +1,107 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __MAPFILEWRITER
+#define __MAPFILEWRITER
+
+#include <string>
+#include <vector>
+
+#include "MapFileReader.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+//! Class for somewhere to write the bytes of map file lines.
+class LineSink
+{
+public:
+
+	virtual ~LineSink() {};
+
+	virtual void write(const FieldView & bytes) = 0;
+};
+
+//! Class to keep the byte ranges of lines to be written later, used when lines are found in parallel but written in order.
+class LineRanges : public LineSink
+{
+private:
+	vector<FieldView> ranges;
+
+public:
+
+	LineRanges() : ranges() {};
+
+	~LineRanges() {};
+
+	void write(const FieldView & bytes);
+	void clear() {ranges.clear();};
+	bool empty() const {return ranges.empty();};
+	const vector<FieldView> & getRanges() const {return ranges;};
+};
+
+//! Class for writing a file from byte ranges, ranges that follow on from each other are joined and long runs are written without copying.
+//! The file may be written as BGZF, with the blocks of each buffer compressed in parallel.
+class MapFileWriter : public LineSink
+{
+private:
+	int fileDescriptor;
+	char * buffer; //short ranges are copied here and written together
+	size_t bufferSize;
+	const char * pendingStart; //range not yet copied or written, joined with the next range if that follows on
+	size_t pendingLength;
+	bool compress;
+	bool copyRanges; //copy each range when it is added, for data that may change after it is added
+	ThreadPool * threadPool; //used to compress blocks, may be null
+	vector<vector<char> > compressedBlocks;
+
+	void writePending();
+	void flush();
+	void compressBuffer();
+	void writeAll(const char * bytes, size_t length);
+
+public:
+
+	MapFileWriter() : fileDescriptor(-1), buffer(0), bufferSize(0), pendingStart(0), pendingLength(0), compress(false), copyRanges(false), threadPool(0), compressedBlocks() {};
+
+	~MapFileWriter()
+	{
+		close();
+	};
+
+	void open(const string & filename, const bool & cmp = false, ThreadPool * tp = 0);
+	void close();
+	bool isOpen() const {return fileDescriptor >= 0;};
+	void write(const FieldView & bytes);
+	void write(const LineRanges & lineRanges);
+	void setCopyRanges(const bool & cr) {copyRanges = cr;};
+};
+
+string getTaggedFileName(const string & filename, const string & tag);
+string getFileNameStem(const string & filename);
+
+#endif
@@ -0,0 +1,497 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "MapThinServer.h"
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+using namespace std;
+
+//! Sets the request from a line of options as given on the command line, ending with the map file and the thinned file.
+//! A line of -stop asks the server to stop. Returns false with an error if the request is not valid.
+bool ThinRequest::parse(const string & line, string & error)
+{
+	istringstream words(line);
+	vector<string> args;
+	string word;
+
+	while(words >> word) args.push_back(word);
+
+	if(args.size() == 1 && args[0] == "-stop")
+	{
+		stop = true;
+		return true;
+	};
+
+	if(args.size() < 2)
+	{
+		error = "A request must end with the map file and the thinned file";
+		return false;
+	};
+
+	size_t noOptions = args.size() - 2;
+
+	for(size_t a = 0; a < noOptions; ++a)
+	{
+		const string & option = args[a];
+
+		if((option == "-t" || option == "-s" || option == "-p" || option == "-chr" || option == "-region") && a + 1 >= noOptions)
+		{
+			error = "No value given for option " + option;
+			return false;
+		};
+
+		if(option == "-b")
+		{
+			useBasePairPosition = true;
+			snpsPerCM = 6.7;
+
+			//a number of SNPs per 10^6 bpp may follow
+			if(a + 1 < noOptions && args[a + 1][0] != '-') snpsPerCM = atof(args[++a].c_str());
+		}
+		else if(option == "-t")
+		{
+			snpsPerCM = atof(args[++a].c_str());
+			snpsPerCMGiven = true;
+		}
+		else if(option == "-s") totalSNPsToKeep = atoi(args[++a].c_str());
+		else if(option == "-p") percentToKeep = atof(args[++a].c_str());
+		else if(option == "-chr")
+		{
+			region = MapRegion();
+			region.chromosome = args[++a];
+		}
+		else if(option == "-region")
+		{
+			region = MapRegion();
+			if(!region.parse(args[++a], error)) return false;
+		}
+		else if(option == "-n") nameOnly = true;
+		else
+		{
+			error = "Unrecognised request option: " + option;
+			return false;
+		};
+	};
+
+	filename = args[noOptions];
+	outputFileName = args[noOptions + 1];
+
+	//VCF files only have base pair positions
+	if(isVCFFileName(filename) && !useBasePairPosition)
+	{
+		useBasePairPosition = true;
+		if(!snpsPerCMGiven) snpsPerCM = 6.7;
+	};
+
+	if(percentToKeep != 0 && !(percentToKeep < 100 && percentToKeep > 0))
+	{
+		error = "The percentage of SNPs to keep must be between 0 and 100";
+		return false;
+	};
+
+	if(filename == outputFileName)
+	{
+		error = "The thinned file cannot replace the map file: " + filename;
+		return false;
+	};
+
+	return true;
+};
+
+//! Returns the cached map for the map file of a request, adding it to the cache if it is not there. The map file is read later,
+//! holding the mutex of the cached map rather than of the cache, so that other map files may be thinned while it is read.
+shared_ptr<CachedMap> MapThinServer::getCachedMap(const ThinRequest & request, string & error)
+{
+	long long size, modified;
+
+	if(!MapFileIndex::getFileStatus(request.filename, size, modified))
+	{
+		error = "Cannot read map file: " + request.filename;
+		return shared_ptr<CachedMap>();
+	};
+
+	//a map file that has changed has a new key, and the old one is left to drop out of the cache
+	ostringstream key;
+	key << request.filename << "\t" << size << "\t" << modified << "\t" << (request.useBasePairPosition ? "bpp" : "cM") << "\t" << request.region.str();
+
+	lock_guard<mutex> lock(cacheMutex);
+
+	for(list<shared_ptr<CachedMap> >::iterator m = cache.begin(); m != cache.end(); ++m)
+	{
+		if((*m)->key == key.str())
+		{
+			cache.splice(cache.begin(), cache, m);
+			return cache.front();
+		};
+	};
+
+	cache.push_front(make_shared<CachedMap>(key.str()));
+
+	//maps dropped from the cache are freed once the requests using them are finished
+	while(cache.size() > cacheSize) cache.pop_back();
+
+	return cache.front();
+};
+
+//! Removes a map from the cache, such as one that could not be read.
+void MapThinServer::removeCachedMap(const shared_ptr<CachedMap> & cachedMap)
+{
+	lock_guard<mutex> lock(cacheMutex);
+
+	cache.remove(cachedMap);
+};
+
+//! Thins the map file of a request and writes the thinned file, returning the answer to send back.
+string MapThinServer::thin(const ThinRequest & request)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	string error;
+
+	shared_ptr<CachedMap> cachedMap = getCachedMap(request, error);
+	if(!cachedMap) return "ERROR " + error;
+
+	lock_guard<mutex> lock(cachedMap->thinMutex);
+	bool wasCached = true;
+
+	if(cachedMap->mapThinner == 0)
+	{
+		cachedMap->mapThinner = new MapThinner(request.filename, request.useBasePairPosition, noThreads, request.region);
+		cachedMap->readError = cachedMap->mapThinner->readMapFiles();
+		cachedMap->mapThinner->setWriteMissingFile(false);
+		wasCached = false;
+
+		if(cachedMap->readError != "") removeCachedMap(cachedMap);
+	};
+
+	if(cachedMap->readError != "") return "ERROR " + cachedMap->readError;
+
+	//the thinned file is checked first as the map thinner does not report files it cannot write
+	{
+		ofstream checkOutput(request.outputFileName.c_str(), ios::app);
+
+		if(!checkOutput.is_open()) return "ERROR Cannot write thinned file: " + request.outputFileName;
+	};
+
+	MapThinner & mapThinner = *cachedMap->mapThinner;
+	ThinStatus status;
+
+	mapThinner.clearRunReport();
+	mapThinner.setOutput(request.outputFileName, request.nameOnly);
+
+	if(request.totalSNPsToKeep > 0) status = mapThinner.SNPThinner::thinToTargetNoSNPs(request.totalSNPsToKeep);
+	else if(request.percentToKeep > 0) status = mapThinner.SNPThinner::thinToTargetPercentNoSNPs(request.percentToKeep);
+	else status = mapThinner.thinSNPs(request.snpsPerCM);
+
+	if(status != thinOK) return "ERROR " + string(getThinStatusMessage(status));
+
+	mapThinner.writeThinnedFiles();
+
+	ostringstream answer;
+	answer << "OK kept=" << mapThinner.getTotalNoThinnedSNPs() << " total=" << mapThinner.getTotalNoSNPs() << " snpsPerCM=" << mapThinner.getSNPsPerCM()
+		<< " missing=" << mapThinner.getNoMissing() << " cached=" << (wasCached ? "yes" : "no")
+		<< " ms=" << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	return answer.str();
+};
+
+#ifndef _WIN32
+
+//! Connects to the socket of a server, returns the connection or -1 if there is no server.
+static int connectSocket(const string & socketPath)
+{
+	struct sockaddr_un address;
+
+	if(socketPath.length() >= sizeof(address.sun_path)) return -1;
+
+	int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(connection < 0) return -1;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, socketPath.c_str(), socketPath.length() + 1);
+
+	if(connect(connection, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(connection);
+		return -1;
+	};
+
+	return connection;
+};
+
+//! Sends all of the bytes, continuing after partial sends. Returns false if the connection is closed.
+static bool sendAll(int connection, const string & data)
+{
+	const char * bytes = data.c_str();
+	size_t length = data.length();
+
+	while(length > 0)
+	{
+		ssize_t noSent = send(connection, bytes, length, 0);
+
+		if(noSent < 0 && errno == EINTR) continue;
+		if(noSent <= 0) return false;
+
+		bytes += noSent;
+		length -= noSent;
+	};
+
+	return true;
+};
+
+//! Receives the next line, without the newline, keeping any bytes after it for the next line. Returns false if the connection is closed.
+static bool receiveLine(int connection, string & received, string & line)
+{
+	char buffer[4096];
+	size_t end;
+
+	while((end = received.find('\n')) == string::npos)
+	{
+		ssize_t noReceived = recv(connection, buffer, sizeof(buffer), 0);
+
+		if(noReceived < 0 && errno == EINTR) continue;
+		if(noReceived <= 0) return false;
+
+		received.append(buffer, noReceived);
+	};
+
+	line = received.substr(0, end);
+	received.erase(0, end + 1);
+
+	if(!line.empty() && line[line.length() - 1] == '\r') line.erase(line.length() - 1);
+
+	return true;
+};
+
+//! Answers the requests sent on a connection, one line at a time, until the client closes it or the server stops.
+void MapThinServer::serveConnection(int connection)
+{
+	string received, line, answer, error;
+	bool stopRequested = false;
+
+	while(!stopRequested && receiveLine(connection, received, line))
+	{
+		if(line.find_first_not_of(" \t") == string::npos) continue;
+
+		ThinRequest request;
+
+		if(!request.parse(line, error)) answer = "ERROR " + error;
+		else if(request.stop)
+		{
+			answer = "OK stopping";
+			stopRequested = true;
+		}
+		else answer = thin(request);
+
+		if(logRequests)
+		{
+			lock_guard<mutex> lock(logMutex);
+			cout << line << "\n\t" << answer << endl;
+		};
+
+		answer += "\n";
+		if(!sendAll(connection, answer)) break;
+	};
+
+	if(stopRequested) stop();
+
+	lock_guard<mutex> lock(connectionMutex);
+
+	close(connection);
+	connections.erase(connection);
+	connectionsFinished.notify_all();
+};
+
+//! Stops the server taking new connections and ends the connections being served after their current requests.
+void MapThinServer::stop()
+{
+	{
+		lock_guard<mutex> lock(connectionMutex);
+
+		if(stopping) return;
+		stopping = true;
+
+		for(set<int>::const_iterator c = connections.begin(); c != connections.end(); ++c) shutdown(*c, SHUT_RD);
+	};
+
+	//wake the server waiting for a connection
+	int wake = connectSocket(socketPath);
+	if(wake >= 0) close(wake);
+};
+
+//! Listens on the socket and serves each connection on its own thread until a stop request. Returns false if the socket cannot be made.
+bool MapThinServer::run()
+{
+	struct sockaddr_un address;
+
+	if(socketPath.length() >= sizeof(address.sun_path))
+	{
+		cerr << "The socket path is too long: " << socketPath << "!\n";
+		return false;
+	};
+
+	//a socket left by a server that did not stop is replaced, but not one in use or any other file
+	struct stat fileStatus;
+	if(lstat(socketPath.c_str(), &fileStatus) == 0)
+	{
+		int existing = connectSocket(socketPath);
+
+		if(!S_ISSOCK(fileStatus.st_mode) || existing >= 0)
+		{
+			if(existing >= 0) close(existing);
+			cerr << "Cannot make socket, " << socketPath << " is already in use!\n";
+			return false;
+		};
+
+		unlink(socketPath.c_str());
+	};
+
+	//clients that close their connection early must not end the server
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, socketPath.c_str(), socketPath.length() + 1);
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(listenSocket < 0 || bind(listenSocket, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listenSocket, 64) != 0)
+	{
+		cerr << "Cannot make socket: " << socketPath << "!\n";
+		if(listenSocket >= 0) close(listenSocket);
+		return false;
+	};
+
+	int connection;
+
+	while(true)
+	{
+		connection = accept(listenSocket, 0, 0);
+
+		if(connection < 0)
+		{
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+
+			cerr << "Cannot accept connections on socket: " << socketPath << "!\n";
+			stop();
+			break;
+		};
+
+		lock_guard<mutex> lock(connectionMutex);
+
+		if(stopping)
+		{
+			close(connection);
+			break;
+		};
+
+		connections.insert(connection);
+		thread(&MapThinServer::serveConnection, this, connection).detach();
+	};
+
+	//the cached maps are freed after the last requests are answered
+	unique_lock<mutex> lock(connectionMutex);
+	connectionsFinished.wait(lock, [this] { return connections.empty(); });
+
+	close(listenSocket);
+	unlink(socketPath.c_str());
+
+	return true;
+};
+
+//! Sends requests to a server one at a time and writes each answer to the screen. Returns 0 if every request was thinned, otherwise 1.
+int runThinClient(const string & socketPath, const vector<string> & requests)
+{
+	int connection = connectSocket(socketPath);
+
+	if(connection < 0)
+	{
+		cerr << "Cannot connect to a server on socket: " << socketPath << "!\n";
+		return 1;
+	};
+
+	signal(SIGPIPE, SIG_IGN);
+
+	string received, answer;
+	int result = 0;
+
+	for(vector<string>::const_iterator r = requests.begin(); r != requests.end(); ++r)
+	{
+		if(!sendAll(connection, *r + "\n") || !receiveLine(connection, received, answer))
+		{
+			cerr << "The server on socket " << socketPath << " closed the connection!\n";
+			result = 1;
+			break;
+		};
+
+		cout << answer << "\n";
+
+		if(answer.substr(0, 2) != "OK") result = 1;
+	};
+
+	close(connection);
+
+	return result;
+};
+
+#else
+
+//! Unix domain sockets are not used on Windows.
+bool MapThinServer::run()
+{
+	cerr << "The server is not available on Windows!\n";
+	return false;
+};
+
+//! Unix domain sockets are not used on Windows.
+int runThinClient(const string & socketPath, const vector<string> & requests)
+{
+	cerr << "The client is not available on Windows!\n";
+	return 1;
+};
+
+#endif
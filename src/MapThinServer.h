@@ -0,0 +1,118 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __MAPTHINSERVER
+#define __MAPTHINSERVER
+
+#include <string>
+#include <vector>
+#include <list>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "Thinner.h"
+
+using namespace std;
+
+//! A map file read by the server, kept so that later requests for it are thinned without reading it again.
+struct CachedMap
+{
+	string key; //map file name, size, modified time, whether base pair positions are used and the region
+	MapThinner * mapThinner; //null until the map file is read
+	string readError; //set if the map file could not be read
+	mutex thinMutex; //requests for the same map file are thinned one at a time
+
+	CachedMap(const string & ky) : key(ky), mapThinner(0), readError(""), thinMutex() {};
+
+	~CachedMap()
+	{
+		delete mapThinner;
+	};
+};
+
+//! A request sent to the server, with the same options as the command line followed by the map file and the thinned file.
+struct ThinRequest
+{
+	string filename;
+	string outputFileName;
+	double snpsPerCM;
+	bool snpsPerCMGiven;
+	unsigned int totalSNPsToKeep;
+	double percentToKeep;
+	bool useBasePairPosition;
+	bool nameOnly;
+	MapRegion region;
+	bool stop; //stop the server after answering
+
+	ThinRequest() : filename(""), outputFileName(""), snpsPerCM(2.4), snpsPerCMGiven(false), totalSNPsToKeep(0), percentToKeep(0), useBasePairPosition(false),
+		nameOnly(false), region(), stop(false) {};
+
+	~ThinRequest() {};
+
+	bool parse(const string & line, string & error);
+};
+
+//! Class for a server thinning map files for requests sent to a local socket, one request on each line with one line sent back for each.
+//! The map files read are kept in a cache, least recently used first out, so that repeated requests for the same map file only thin
+//! and write. Each connection is served by its own thread.
+class MapThinServer
+{
+private:
+	string socketPath;
+	unsigned int noThreads; //used to thin each map file
+	size_t cacheSize; //the most map files kept
+	list<shared_ptr<CachedMap> > cache; //most recently used first
+	mutex cacheMutex;
+	bool logRequests; //write each request and its answer to the screen
+	mutex logMutex;
+	int listenSocket;
+	bool stopping;
+	set<int> connections; //being served
+	mutex connectionMutex;
+	condition_variable connectionsFinished;
+
+	shared_ptr<CachedMap> getCachedMap(const ThinRequest & request, string & error);
+	void removeCachedMap(const shared_ptr<CachedMap> & cachedMap);
+	string thin(const ThinRequest & request);
+	void serveConnection(int connection);
+	void stop();
+
+public:
+
+	MapThinServer(const string & sp, const unsigned int & nt, const size_t & cs, const bool & lr) : socketPath(sp), noThreads(nt), cacheSize(cs), cache(), cacheMutex(),
+		logRequests(lr), logMutex(), listenSocket(-1), stopping(false), connections(), connectionMutex(), connectionsFinished() {};
+
+	~MapThinServer() {};
+
+	bool run();
+};
+
+int runThinClient(const string & socketPath, const vector<string> & requests);
+
+#endif
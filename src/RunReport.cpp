@@ -0,0 +1,172 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "RunReport.h"
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <sstream>
+#include <chrono>
+#include <ctime>
+#include <math.h>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+//! Starts timing a phase of the run, time in a phase entered more than once is added up.
+void RunReport::startPhase(const string & name)
+{
+	endPhase();
+
+	for(currentPhase = 0; currentPhase < phases.size(); ++currentPhase)
+	{
+		if(phases[currentPhase].name == name) break;
+	};
+
+	if(currentPhase == phases.size()) phases.push_back(PhaseTime(name));
+
+	phases[currentPhase].noTimes++;
+	phaseStart = chrono::steady_clock::now();
+	phaseCPUStart = clock();
+};
+
+//! Stops timing the current phase.
+void RunReport::endPhase()
+{
+	if(currentPhase >= phases.size()) return;
+
+	phases[currentPhase].wallSeconds += chrono::duration<double>(chrono::steady_clock::now() - phaseStart).count();
+	phases[currentPhase].cpuSeconds += (double)(clock() - phaseCPUStart)/(double)CLOCKS_PER_SEC;
+	currentPhase = phases.size();
+};
+
+//! Returns the peak resident memory of the process in KB, or 0 if it is not known.
+long RunReport::getPeakMemoryKB()
+{
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return usage.ru_maxrss/1024; //in bytes on macOS
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+};
+
+//! Writes a string in quotes with JSON escapes.
+void RunReport::writeString(ostream & report, const string & value)
+{
+	report << "\"";
+
+	for(string::const_iterator c = value.begin(); c != value.end(); ++c)
+	{
+		if(*c == '"' || *c == '\\') report << "\\" << *c;
+		else if(*c == '\n') report << "\\n";
+		else if(*c == '\t') report << "\\t";
+		else if((unsigned char)*c < 0x20)
+		{
+			const char * hex = "0123456789abcdef";
+			report << "\\u00" << hex[(*c >> 4) & 0xf] << hex[*c & 0xf];
+		}
+		else report << *c;
+	};
+
+	report << "\"";
+};
+
+//! Writes a number, JSON has no infinity or NaN so these are written as null.
+void RunReport::writeNumber(ostream & report, const double & value)
+{
+	if(!isfinite(value))
+	{
+		report << "null";
+		return;
+	};
+
+	ostringstream number;
+	number.precision(10);
+	number << value;
+	report << number.str();
+};
+
+//! Writes the times of the phases, the total time, the passes over the input and the peak memory.
+void RunReport::writeTimes(ostream & report, const string & indent) const
+{
+	report << indent << "\"phases\": [";
+
+	for(vector<PhaseTime>::const_iterator p = phases.begin(); p != phases.end(); ++p)
+	{
+		double wallSeconds = p->wallSeconds;
+		double cpuSeconds = p->cpuSeconds;
+
+		//include the time so far of a phase not yet ended
+		if((size_t)(p - phases.begin()) == currentPhase)
+		{
+			wallSeconds += chrono::duration<double>(chrono::steady_clock::now() - phaseStart).count();
+			cpuSeconds += (double)(clock() - phaseCPUStart)/(double)CLOCKS_PER_SEC;
+		};
+
+		report << (p == phases.begin() ? "\n" : ",\n") << indent << "\t{\"name\": ";
+		writeString(report, p->name);
+		report << ", \"wallSeconds\": "; writeNumber(report, wallSeconds);
+		report << ", \"cpuSeconds\": "; writeNumber(report, cpuSeconds);
+		report << ", \"times\": " << p->noTimes << "}";
+	};
+
+	report << "\n" << indent << "],\n";
+
+	report << indent << "\"totalWallSeconds\": "; writeNumber(report, chrono::duration<double>(chrono::steady_clock::now() - runStart).count());
+	report << ",\n" << indent << "\"totalCpuSeconds\": "; writeNumber(report, (double)(clock() - runCPUStart)/(double)CLOCKS_PER_SEC);
+	report << ",\n" << indent << "\"passesOverInput\": " << noPasses;
+	report << ",\n" << indent << "\"bytesRead\": " << bytesRead;
+	report << ",\n" << indent << "\"linesRead\": " << linesRead;
+	report << ",\n" << indent << "\"peakMemoryKB\": " << getPeakMemoryKB();
+};
+
+//! Writes the tries of the search for the SNPs per cM giving a target number of SNPs.
+void RunReport::writeSearch(ostream & report, const string & indent) const
+{
+	report << indent << "\"searchRounds\": " << noSearchRounds << ",\n";
+	report << indent << "\"searchTries\": [";
+
+	for(vector<SearchTry>::const_iterator t = searchTries.begin(); t != searchTries.end(); ++t)
+	{
+		report << (t == searchTries.begin() ? "\n" : ",\n") << indent << "\t{\"round\": " << t->round << ", \"snpsPerCM\": ";
+		writeNumber(report, t->snpsPerCM);
+		report << ", \"noSNPs\": " << t->noSNPs << "}";
+	};
+
+	report << (searchTries.empty() ? "]" : "\n" + indent + "]");
+};
@@ -0,0 +1,97 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __RUNREPORT
+#define __RUNREPORT
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <chrono>
+#include <ctime>
+
+using namespace std;
+
+//! Class to store the time spent in one phase of a run.
+struct PhaseTime
+{
+	string name;
+	double wallSeconds;
+	double cpuSeconds; //of all threads
+	unsigned int noTimes; //the phase was entered
+
+	PhaseTime(const string & nm) : name(nm), wallSeconds(0), cpuSeconds(0), noTimes(0) {};
+
+	~PhaseTime() {};
+};
+
+//! Class to store one try of the search for the SNPs per cM giving a target number of SNPs.
+struct SearchTry
+{
+	unsigned int round; //tries in the same round are counted together
+	double snpsPerCM;
+	unsigned int noSNPs;
+
+	SearchTry(const unsigned int & rd, const double & spc, const unsigned int & ns) : round(rd), snpsPerCM(spc), noSNPs(ns) {};
+
+	~SearchTry() {};
+};
+
+//! Class to record where the time of a run goes and the work done, for writing a report of the run.
+class RunReport
+{
+private:
+	vector<PhaseTime> phases;
+	size_t currentPhase; //index of the phase being timed, or the number of phases if none
+	chrono::steady_clock::time_point runStart, phaseStart;
+	clock_t runCPUStart, phaseCPUStart;
+	unsigned int noPasses; //full passes over the input data
+	unsigned long long bytesRead, linesRead;
+	vector<SearchTry> searchTries;
+	unsigned int noSearchRounds;
+
+public:
+
+	RunReport() : phases(), currentPhase(0), runStart(chrono::steady_clock::now()), phaseStart(runStart), runCPUStart(clock()), phaseCPUStart(runCPUStart),
+		noPasses(0), bytesRead(0), linesRead(0), searchTries(), noSearchRounds(0) {};
+
+	~RunReport() {};
+
+	void startPhase(const string & name);
+	void endPhase();
+	void addPass(const unsigned long long & noBytes, const unsigned long long & noLines) {noPasses++; bytesRead += noBytes; linesRead += noLines;};
+	void startSearchRound() {noSearchRounds++;};
+	void addSearchTry(const double & snpsPerCM, const unsigned int & noSNPs) {searchTries.push_back(SearchTry(noSearchRounds, snpsPerCM, noSNPs));};
+	void writeTimes(ostream & report, const string & indent) const;
+	void writeSearch(ostream & report, const string & indent) const;
+
+	static long getPeakMemoryKB();
+	static void writeString(ostream & report, const string & value);
+	static void writeNumber(ostream & report, const double & value);
+};
+
+#endif
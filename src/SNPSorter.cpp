@@ -0,0 +1,243 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "SNPSorter.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+//! Key of SNPs with missing positions, which are put after the other SNPs of their chromosome so that they are not kept.
+static const uint64_t missingKey = ~(uint64_t)0;
+
+static const uint64_t signBit = (uint64_t)1 << 63;
+
+//! Number of passes of the radix sort, one for each byte of the key and then of the chromosome.
+static const unsigned int noRadixPasses = 12;
+
+//! Fewest records sorted by each thread in a pass of the radix sort.
+static const size_t minRecordsPerThread = 1 << 16;
+
+//! Returns the byte of a record sorted on in a pass of the radix sort.
+static inline unsigned int getRadixDigit(const SortRecord & record, const unsigned int & pass)
+{
+	if(pass < 8) return (record.key >> (8*pass)) & 255;
+
+	return (record.chromosome >> (8*(pass - 8))) & 255;
+};
+
+//! Returns whether run a comes after run b, for a heap of runs with the run of the smallest next record at the top.
+static inline bool isLaterRun(const vector<SortRun> & runs, const size_t & a, const size_t & b)
+{
+	return runs[b].buffer[runs[b].position] < runs[a].buffer[runs[a].position];
+};
+
+//! Sets up the sorter to sort in memory as many records as fit in half of the memory given, the other half is for the radix sort.
+SNPSorter::SNPSorter(ThreadPool & tp, const size_t & memoryBudget) : threadPool(tp), maxRunRecords(memoryBudget/(2*sizeof(SortRecord))), records(), buffer(),
+	nextRecord(0), runs(), heap(), failed(false)
+{
+	if(maxRunRecords < 1024) maxRunRecords = 1024;
+};
+
+//! Closes the temporary files, which removes them.
+SNPSorter::~SNPSorter()
+{
+	for(vector<SortRun>::iterator r = runs.begin(); r != runs.end(); ++r) fclose(r->file);
+};
+
+//! Returns a key for a position that orders as the positions do, as an unsigned integer.
+uint64_t SNPSorter::getPositionKey(const double & position)
+{
+	if(position == 0) return missingKey;
+
+	uint64_t bits;
+	memcpy(&bits, &position, sizeof(bits));
+
+	//negative positions have every bit flipped so that larger magnitudes come first
+	uint64_t key = (bits & signBit) ? ~bits : bits | signBit;
+	if(key == missingKey) key--;
+
+	return key;
+};
+
+//! Returns the position of a key.
+double SNPSorter::getKeyPosition(const uint64_t & key)
+{
+	if(key == missingKey) return 0;
+
+	uint64_t bits = (key & signBit) ? key & ~signBit : ~key;
+	double position;
+	memcpy(&position, &bits, sizeof(position));
+
+	return position;
+};
+
+//! Sorts the records in memory with a least significant digit radix sort, a byte at a time, which keeps records with the same
+//! chromosome and position in the order they were added. Each thread counts and moves the records of its own block, and
+//! passes where every record has the same byte, such as the high bytes of the chromosome, are skipped.
+void SNPSorter::sortRecords()
+{
+	size_t noRecords = records.size();
+	size_t noBlocks = noRecords/minRecordsPerThread;
+	if(noBlocks > threadPool.getNoThreads()) noBlocks = threadPool.getNoThreads();
+	if(noBlocks < 1) noBlocks = 1;
+
+	size_t blockSize = (noRecords + noBlocks - 1)/noBlocks;
+	vector<size_t> counts(noBlocks*256);
+
+	buffer.resize(noRecords);
+
+	for(unsigned int pass = 0; pass < noRadixPasses; ++pass)
+	{
+		fill(counts.begin(), counts.end(), 0);
+
+		threadPool.run(noBlocks, [&](size_t b)
+		{
+			size_t * blockCounts = &counts[b*256];
+			vector<SortRecord>::const_iterator end = records.begin() + min(noRecords, (b + 1)*blockSize);
+
+			for(vector<SortRecord>::const_iterator r = records.begin() + min(noRecords, b*blockSize); r != end; ++r) blockCounts[getRadixDigit(*r, pass)]++;
+		});
+
+		//skip the pass if every record has the same byte
+		size_t digitTotal = 0;
+		unsigned int digit = 0;
+
+		for( ; digit < 256 && digitTotal == 0; ++digit)
+		{
+			for(size_t b = 0; b < noBlocks; ++b) digitTotal += counts[b*256 + digit];
+		};
+
+		if(digitTotal == noRecords) continue;
+
+		//each block moves its records of each digit after those of the blocks before
+		size_t offset = 0, count;
+
+		for(digit = 0; digit < 256; ++digit)
+		{
+			for(size_t b = 0; b < noBlocks; ++b)
+			{
+				count = counts[b*256 + digit];
+				counts[b*256 + digit] = offset;
+				offset += count;
+			};
+		};
+
+		threadPool.run(noBlocks, [&](size_t b)
+		{
+			size_t * blockOffsets = &counts[b*256];
+			vector<SortRecord>::const_iterator end = records.begin() + min(noRecords, (b + 1)*blockSize);
+
+			for(vector<SortRecord>::const_iterator r = records.begin() + min(noRecords, b*blockSize); r != end; ++r) buffer[blockOffsets[getRadixDigit(*r, pass)]++] = *r;
+		});
+
+		records.swap(buffer);
+	};
+};
+
+//! Sorts the records added and spills them to a temporary file as a run, to be merged with the other runs.
+void SNPSorter::spillRun()
+{
+	if(records.empty()) return;
+
+	sortRecords();
+
+	FILE * file = tmpfile();
+
+	if(file == 0 || fwrite(&records[0], sizeof(SortRecord), records.size(), file) != records.size()) failed = true;
+	if(file != 0) runs.push_back(SortRun(file));
+
+	records.clear();
+};
+
+//! Reads the next records of a run into its buffer, returns false if there are none left.
+bool SNPSorter::fillRunBuffer(SortRun & run, const size_t & bufferSize)
+{
+	run.buffer.resize(bufferSize);
+	run.buffer.resize(fread(&run.buffer[0], sizeof(SortRecord), bufferSize, run.file));
+	run.position = 0;
+
+	if(ferror(run.file)) failed = true;
+
+	return !run.buffer.empty();
+};
+
+//! Sorts the records after they have all been added. If runs were spilled the last records are spilled too, and the runs
+//! are read back to be merged, each with a buffer sharing the memory given.
+void SNPSorter::finish()
+{
+	if(runs.empty())
+	{
+		sortRecords();
+		vector<SortRecord>().swap(buffer);
+		nextRecord = 0;
+		return;
+	};
+
+	spillRun();
+	vector<SortRecord>().swap(records);
+	vector<SortRecord>().swap(buffer);
+
+	size_t bufferSize = 2*maxRunRecords/runs.size();
+	if(bufferSize < 1024) bufferSize = 1024;
+
+	for(size_t r = 0; r < runs.size(); ++r)
+	{
+		rewind(runs[r].file);
+		if(fillRunBuffer(runs[r], bufferSize)) heap.push_back(r);
+	};
+
+	make_heap(heap.begin(), heap.end(), [this](const size_t & a, const size_t & b) { return isLaterRun(runs, a, b); });
+};
+
+//! Takes the next record in sorted order, returns false when there are none left.
+bool SNPSorter::next(SortRecord & record)
+{
+	if(runs.empty())
+	{
+		if(nextRecord == records.size()) return false;
+
+		record = records[nextRecord++];
+		return true;
+	};
+
+	if(heap.empty() || failed) return false;
+
+	//take the smallest next record of the runs, then put its run back in the heap if it has more
+	auto later = [this](const size_t & a, const size_t & b) { return isLaterRun(runs, a, b); };
+
+	pop_heap(heap.begin(), heap.end(), later);
+	SortRun & run = runs[heap.back()];
+	record = run.buffer[run.position++];
+
+	if(run.position == run.buffer.size() && !fillRunBuffer(run, run.buffer.size())) heap.pop_back();
+	else push_heap(heap.begin(), heap.end(), later);
+
+	return true;
+};
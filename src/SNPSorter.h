@@ -0,0 +1,110 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __SNPSORTER
+#define __SNPSORTER
+
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+//! Class to store the sort key of one SNP, its chromosome and position, and the index of the SNP.
+struct SortRecord
+{
+	uint64_t key; //of the position, ordered as the positions are
+	uint32_t chromosome; //rank of the chromosome
+	uint32_t snp;
+
+	SortRecord() : key(0), chromosome(0), snp(0) {};
+	SortRecord(const uint64_t & ky, const uint32_t & chr, const uint32_t & sn) : key(ky), chromosome(chr), snp(sn) {};
+
+	~SortRecord() {};
+
+	bool operator<(const SortRecord & record) const;
+};
+
+//! Returns whether a record comes before another, SNPs with the same chromosome and position are kept in the order of their indices.
+inline bool SortRecord::operator<(const SortRecord & record) const
+{
+	if(chromosome != record.chromosome) return chromosome < record.chromosome;
+	if(key != record.key) return key < record.key;
+	return snp < record.snp;
+};
+
+//! Class to store a run of sorted records spilled to a temporary file, read back a buffer at a time when the runs are merged.
+struct SortRun
+{
+	FILE * file;
+	vector<SortRecord> buffer;
+	size_t position; //of the next record in the buffer
+
+	SortRun(FILE * fl) : file(fl), buffer(), position(0) {};
+
+	~SortRun() {};
+};
+
+//! Class for sorting SNPs on chromosome and position with a parallel radix sort. The records are added in the order of the SNPs, and if
+//! there are more than fit in the memory given the runs that fit are sorted and spilled to temporary files, which are merged as the
+//! records are taken.
+class SNPSorter
+{
+private:
+	ThreadPool & threadPool;
+	size_t maxRunRecords; //records that are sorted in memory at once
+	vector<SortRecord> records; //being added, or sorted if there are no runs
+	vector<SortRecord> buffer; //for the radix sort
+	size_t nextRecord; //to take if there are no runs
+	vector<SortRun> runs;
+	vector<size_t> heap; //of the runs by their next record, when merging
+	bool failed; //a temporary file could not be written or read
+
+	void sortRecords();
+	void spillRun();
+	bool fillRunBuffer(SortRun & run, const size_t & bufferSize);
+
+public:
+
+	SNPSorter(ThreadPool & tp, const size_t & memoryBudget);
+
+	~SNPSorter();
+
+	void reserve(const size_t & noRecords) {records.reserve(noRecords < maxRunRecords ? noRecords : maxRunRecords);};
+	void add(const SortRecord & record) {records.push_back(record); if(records.size() == maxRunRecords) spillRun();};
+	void finish();
+	bool next(SortRecord & record);
+	bool hasFailed() const {return failed;};
+	size_t getNoRuns() const {return runs.size();};
+
+	static uint64_t getPositionKey(const double & position);
+	static double getKeyPosition(const uint64_t & key);
+};
+
+#endif
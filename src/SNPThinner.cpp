@@ -0,0 +1,1119 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#include "SNPThinner.h"
+#include "SNPSorter.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <math.h>
+
+using namespace std;
+
+//! Returns the position of the lowest set bit.
+static inline unsigned int lowestBit(const uint64_t & bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#else
+	unsigned int bit = 0;
+	while(!(bits & ((uint64_t)1 << bit))) ++bit;
+	return bit;
+#endif
+};
+
+//! The sparse kernel is used for sorted positions when fewer than one SNP in this many is expected to be kept.
+static const double sparseThinningRatio = 32;
+
+//! Returns the first position after a marker from sorted positions, or last if there is none.
+//! The steps from first double until past the marker, then the search in the last step has no branches.
+static inline const double * findFirstAfter(const double * first, const double * last, const double & marker)
+{
+	size_t noPositions = last - first;
+	if(noPositions == 0 || *first > marker) return first;
+
+	size_t low = 0;
+	size_t high = 1;
+	while(high < noPositions && first[high] <= marker)
+	{
+		low = high;
+		high = 2*high + 1;
+	};
+
+	if(high > noPositions) high = noPositions;
+
+	//first[low] <= marker, and first[high] > marker or high is the end
+	const double * base = first + low + 1;
+	size_t length = high - low - 1;
+	while(length > 0)
+	{
+		size_t half = (length + 1)/2;
+		base = (base[half - 1] <= marker) ? base + half : base;
+		length -= half;
+	};
+
+	return base;
+};
+
+//! Chromosomes thinned with the linear loop are split into segments thinned in parallel when larger than this and the SNPs per thread.
+static const size_t minSegmentNoSNPs = 1 << 18;
+
+//! Number of choices kept from the start of a segment thinned from a guessed state, to find where the true choices meet them.
+static const size_t maxGuessedChoices = 256;
+
+//! No SNP was included at a choice of the thinning walk.
+static const size_t noneIncluded = numeric_limits<size_t>::max();
+
+//! Makes the choice of the thinning walk of includeSNPsForFinal at SNP i, the first SNP past the marker, and moves on the marker.
+//! Returns the SNP included, or noneIncluded.
+static inline size_t chooseSNP(const double * geneDis, const size_t & i, const double & geneDisStep, WalkState & state)
+{
+	size_t included = noneIncluded;
+
+	//pick closest SNP to marker or second if first is already chosen
+	if((geneDis[i] - state.marker) < (state.marker - geneDis[i - 1]) || state.lastIncluded == i - 1)
+	{
+		if(geneDis[i] != state.prevIncludeGeneDis) included = i;
+		state.prevIncludeGeneDis = geneDis[i];
+	}
+	else
+	{
+		if(geneDis[i - 1] != state.prevIncludeGeneDis) included = i - 1;
+		state.prevIncludeGeneDis = geneDis[i - 1];
+	};
+
+	if(included != noneIncluded) state.lastIncluded = included;
+
+	//move on marker past the geneDis of the last included SNP
+	do{ state.marker += geneDisStep; }while(state.marker <= state.prevIncludeGeneDis);
+
+	return included;
+};
+
+//! Runs the thinning walk of includeSNPsForFinal choosing between the SNPs within a window of each marker on their scores, calling
+//! include with each SNP included. At the first SNP past the marker, the SNPs in the window after the last SNP included are taken,
+//! and the one with the highest score is included, or the closest to the marker if the scores are the same. With no SNP in the window
+//! the SNP is chosen as without scores.
+template<class Include> static void walkScoredSNPs(const double * geneDis, const float * scores, const size_t & noSNPs, const double & geneDisStep,
+	const double & window, Include include)
+{
+	double marker = geneDis[0] + geneDisStep;
+	double prevIncludeGeneDis = geneDis[0];
+	size_t lastIncluded = 0;
+	size_t first, last, chosen;
+
+	//include the first SNP
+	include(0);
+
+	for(size_t i = 1; i < noSNPs; ++i)
+	{
+		if(!(geneDis[i] > marker)) continue;
+
+		//the SNPs in the window are next to each other in a chromosome in order, either side of the marker, with any missing
+		//positions of 0 among them passed over
+		first = i;
+		while(first - 1 > lastIncluded && (geneDis[first - 1] >= marker - window || geneDis[first - 1] == 0)) first--;
+		last = i - 1;
+		while(last + 1 < noSNPs && geneDis[last + 1] <= marker + window) last++;
+
+		chosen = noneIncluded;
+		for(size_t j = first; j <= last; ++j)
+		{
+			if(geneDis[j] == prevIncludeGeneDis || geneDis[j] == 0) continue;
+
+			if(chosen == noneIncluded || scores[j] > scores[chosen]
+				|| (scores[j] == scores[chosen] && fabs(geneDis[j] - marker) < fabs(geneDis[chosen] - marker))) chosen = j;
+		};
+
+		if(chosen != noneIncluded)
+		{
+			include(chosen);
+			lastIncluded = chosen;
+			prevIncludeGeneDis = geneDis[chosen];
+			if(chosen > i) i = chosen;
+		}
+		else if((geneDis[i] - marker) < (marker - geneDis[i - 1]) || lastIncluded == i - 1)
+		{
+			//pick closest SNP to marker or second if first is already chosen
+			if(geneDis[i] != prevIncludeGeneDis)
+			{
+				include(i);
+				lastIncluded = i;
+			};
+			prevIncludeGeneDis = geneDis[i];
+		}
+		else
+		{
+			if(geneDis[i - 1] != prevIncludeGeneDis)
+			{
+				include(i - 1);
+				lastIncluded = i - 1;
+			};
+			prevIncludeGeneDis = geneDis[i - 1];
+		};
+
+		//move on marker past the geneDis of the last included SNP
+		do{ marker += geneDisStep; }while(marker <= prevIncludeGeneDis);
+	};
+};
+
+//! Returns a description of the result of a thinning.
+const char * getThinStatusMessage(const ThinStatus & status)
+{
+	switch(status)
+	{
+		case thinOK: return "The SNPs were thinned";
+		case thinBadSNPsPerCM: return "The SNPs per cM must not be negative";
+		case thinBadTarget: return "The number of SNPs to keep must be between 0 and the number of SNPs";
+		case thinBadPercent: return "The percentage of SNPs to keep must be between 0 and 100";
+		case thinTooManyMissing: return "There are fewer SNPs with positions than the number of SNPs to keep";
+	};
+
+	return "Unknown thinning status";
+};
+
+//! Starts the SNPs of a new chromosome, the SNPs are then added in order with addSNP.
+void SNPThinner::startChromosome(const string & name, const size_t & filePosition)
+{
+	theChromosomes.push_back(Chromosome(name, geneticDistances.size(), filePosition));
+	prevGeneDis = -1;
+};
+
+//! Gives each chromosome its own words of include flags, after all of the SNPs are added.
+void SNPThinner::setIncludeWords()
+{
+	size_t noIncludeWords = 0;
+	for(vector<Chromosome>::iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
+	{
+		c->firstIncludeWord = noIncludeWords;
+		noIncludeWords += (c->noSNPs + 63)/64;
+	};
+
+	includeSNPs.assign(noIncludeWords, 0);
+
+	//SNPs added after the last score is set have no score
+	if(!snpScores.empty()) snpScores.resize(geneticDistances.size(), noSNPScore);
+};
+
+//! Adds the positions of the SNPs of a chromosome, in cM (or base pair position), 0 if missing, and optionally the scores of the SNPs,
+//! noSNPScore if missing. The positions and scores are copied.
+void SNPThinner::addChromosome(const string & name, const double * positions, const size_t & noPositions, const float * scores)
+{
+	startChromosome(name, 0);
+
+	geneticDistances.reserve(geneticDistances.size() + noPositions);
+	for(size_t i = 0; i < noPositions; ++i)
+	{
+		addSNP(positions[i]);
+		if(scores != 0) addSNPScore(scores[i]);
+	};
+
+	setIncludeWords();
+};
+
+//! Thins the SNPs with a number of SNPs per cM (or per 10^6 bpp), marking the SNPs to keep.
+ThinStatus SNPThinner::thinSNPs(const double & spc)
+{
+	if(!(spc >= 0)) return thinBadSNPsPerCM;
+
+	snpsPerCM = spc;
+
+	runReport.startPhase("thin");
+
+	double geneDisStep = getGeneDisStep(snpsPerCM);
+	unsigned int noThreads = threadPool.getNoThreads();
+
+	//chromosomes with more SNPs than a thread's share are split into segments when thinned with the linear loop, but not with scores
+	size_t segmentNoSNPs = ((totalNoSNPs/noThreads + 63)/64)*64;
+	if(segmentNoSNPs < minSegmentNoSNPs) segmentNoSNPs = minSegmentNoSNPs;
+
+	vector<size_t> wholeChromosomes;
+	vector<ChromosomeSegment> segments;
+	vector<size_t> firstSegments; //of each split chromosome, and the end of the last
+
+	for(size_t c = 0; c < theChromosomes.size(); ++c)
+	{
+		const Chromosome & chromosome = theChromosomes[c];
+
+		if(noThreads == 1 || chromosome.noSNPs <= segmentNoSNPs || !snpScores.empty() || useSparseKernel(chromosome, geneDisStep))
+		{
+			wholeChromosomes.push_back(c);
+			continue;
+		};
+
+		firstSegments.push_back(segments.size());
+
+		//segments after the first start at a new word of include flags
+		for(size_t begin = 1, end; begin < chromosome.noSNPs; begin = end)
+		{
+			end = min(begin - begin % segmentNoSNPs + segmentNoSNPs, chromosome.noSNPs);
+			segments.push_back(ChromosomeSegment(c, begin, end));
+		};
+	};
+
+	firstSegments.push_back(segments.size());
+
+	//the chromosomes are thinned independently, so may be done in parallel, and the segments are thinned at the same time from guessed states
+	threadPool.run(wholeChromosomes.size() + segments.size(), [&](size_t t)
+	{
+		if(t < wholeChromosomes.size()) thinChromosome(theChromosomes[wholeChromosomes[t]]);
+		else thinSegmentFromGuess(segments[t - wholeChromosomes.size()], geneDisStep);
+	});
+
+	//the segments of each chromosome are then joined in order, correcting the start of each from the true end of the one before
+	threadPool.run(firstSegments.size() - 1, [&](size_t s)
+	{
+		joinSegments(segments.begin() + firstSegments[s], segments.begin() + firstSegments[s + 1], geneDisStep);
+	});
+
+	runReport.endPhase();
+
+	return thinOK;
+};
+
+//! Thins a segment of a chromosome from a guessed state of the thinning walk at its start, which is that the SNP before the segment was
+//! included and the marker moved on past it. The guess is the true state for the first segment. The true walk usually makes the same
+//! choices as the guessed one within a few markers, as both move the markers on from the SNPs they include.
+void SNPThinner::thinSegmentFromGuess(ChromosomeSegment & segment, const double & geneDisStep)
+{
+	const Chromosome & chromosome = theChromosomes[segment.chromosome];
+	const double * geneDis = &geneticDistances[chromosome.firstSNP];
+	WalkState & state = segment.endState;
+
+	clearIncludeWords(chromosome, segment.begin, segment.end);
+
+	//the marker is built up by adding steps from the first SNP, as in the walk, so that it is the same to the last bit
+	state.prevIncludeGeneDis = geneDis[segment.begin - 1];
+	state.lastIncluded = segment.begin - 1;
+	state.marker = geneDis[0] + geneDisStep;
+	while(state.marker <= state.prevIncludeGeneDis) state.marker += geneDisStep;
+
+	//include the first SNP
+	if(segment.begin == 1) setIncluded(chromosome, 0);
+
+	walkSNPs(chromosome, geneDisStep, segment.begin, segment.end, state, segment.choices, maxGuessedChoices);
+};
+
+//! Runs the thinning walk of includeSNPsForFinal over SNPs begin to end of a chromosome, marking the SNPs included and keeping the first choices made.
+//! The SNP before begin is not marked, as it may belong to the segment before.
+void SNPThinner::walkSNPs(const Chromosome & chromosome, const double & geneDisStep, const size_t & begin, const size_t & end, WalkState & state,
+	vector<WalkChoice> & choices, const size_t & maxNoChoices)
+{
+	const double * geneDis = &geneticDistances[chromosome.firstSNP];
+	size_t included;
+
+	for(size_t i = begin; i != end; ++i)
+	{
+		if(!(geneDis[i] > state.marker)) continue;
+
+		included = chooseSNP(geneDis, i, geneDisStep, state);
+		if(included != noneIncluded && included >= begin) setIncluded(chromosome, included);
+
+		if(choices.size() < maxNoChoices) choices.push_back(WalkChoice(i, included, state));
+	};
+};
+
+//! Runs the thinning walk from the true state at the start of a segment, adding the choices made, until a choice has the same state after it as
+//! the choice made at the same SNP from the guessed state, after which the choices are the same. Returns the index of that guessed choice,
+//! or the number of guessed choices kept if the walks do not meet within them.
+size_t SNPThinner::meetGuessedChoices(const ChromosomeSegment & segment, const double & geneDisStep, WalkState & state, vector<WalkChoice> & choices) const
+{
+	const vector<WalkChoice> & guessed = segment.choices;
+	if(guessed.empty()) return 0;
+
+	const double * geneDis = &geneticDistances[theChromosomes[segment.chromosome].firstSNP];
+	size_t included;
+	size_t g = 0;
+
+	for(size_t i = segment.begin; i <= guessed.back().snp; ++i)
+	{
+		if(!(geneDis[i] > state.marker)) continue;
+
+		included = chooseSNP(geneDis, i, geneDisStep, state);
+		choices.push_back(WalkChoice(i, included, state));
+
+		while(guessed[g].snp < i) ++g;
+
+		//only whether this SNP is included matters for the choices after, not which SNP was last included
+		if(guessed[g].snp == i && guessed[g].marker == state.marker && guessed[g].prevIncludeGeneDis == state.prevIncludeGeneDis
+			&& (guessed[g].included == i) == (included == i)) return g;
+	};
+
+	return guessed.size();
+};
+
+//! Joins the segments of a chromosome thinned from guessed states, so that the SNPs included are the same as thinning the chromosome in one walk.
+//! The start of each segment is thinned again from the true state at the end of the segment before, until it meets the guessed choices.
+void SNPThinner::joinSegments(const vector<ChromosomeSegment>::const_iterator & firstSegment, const vector<ChromosomeSegment>::const_iterator & lastSegment,
+	const double & geneDisStep)
+{
+	Chromosome & chromosome = theChromosomes[firstSegment->chromosome];
+	WalkState state = firstSegment->endState;
+	WalkState startState;
+	vector<WalkChoice> choices;
+	size_t met;
+
+	chromosome.noIncluded = 0;
+	chromosome.gapStats.clear();
+
+	for(vector<ChromosomeSegment>::const_iterator segment = firstSegment + 1; segment != lastSegment; ++segment)
+	{
+		startState = state;
+		choices.clear();
+		met = meetGuessedChoices(*segment, geneDisStep, state, choices);
+
+		if(met < segment->choices.size())
+		{
+			//replace the guessed choices up to where the walks meet with the true ones
+			for(vector<WalkChoice>::const_iterator c = segment->choices.begin(); c != segment->choices.begin() + met + 1; ++c)
+			{
+				if(c->included != noneIncluded && c->included >= segment->begin) clearIncluded(chromosome, c->included);
+			};
+
+			//the guessed last included SNP is true if it is from a choice after the walks meet
+			if(segment->endState.lastIncluded >= segment->choices[met].snp) state.lastIncluded = segment->endState.lastIncluded;
+			state.marker = segment->endState.marker;
+			state.prevIncludeGeneDis = segment->endState.prevIncludeGeneDis;
+		}
+		else
+		{
+			//the walks did not meet, so thin the whole segment again
+			clearIncludeWords(chromosome, segment->begin, segment->end);
+			state = startState;
+			choices.clear();
+			walkSNPs(chromosome, geneDisStep, segment->begin, segment->end, state, choices, 1);
+		};
+
+		for(vector<WalkChoice>::const_iterator c = choices.begin(); c != choices.end(); ++c)
+		{
+			if(c->included != noneIncluded) setIncluded(chromosome, c->included);
+		};
+	};
+
+	addIncludedGapStats(chromosome);
+};
+
+//! Marks the SNPs of one chromosome to include in the final file.
+void SNPThinner::thinChromosome(Chromosome & chromosome)
+{
+	chromosome.noIncluded = 0;
+	chromosome.gapStats.clear();
+	if(chromosome.noSNPs == 0) return;
+
+	clearIncludeWords(chromosome, 0, chromosome.noSNPs);
+
+	//set which SNPs are to be included in the final file
+	includeSNPsForFinal(chromosome);
+
+	addIncludedGapStats(chromosome);
+};
+
+//! Counts the SNPs of a chromosome that are included, and gathers the stats of the gaps between them.
+void SNPThinner::addIncludedGapStats(Chromosome & chromosome)
+{
+	vector<uint64_t>::const_iterator wordsBegin = includeSNPs.begin() + chromosome.firstIncludeWord;
+	vector<uint64_t>::const_iterator wordsEnd = wordsBegin + (chromosome.noSNPs + 63)/64;
+	const double * geneDis = &geneticDistances[chromosome.firstSNP];
+	size_t snp;
+	uint64_t bits;
+
+	for(vector<uint64_t>::const_iterator w = wordsBegin; w != wordsEnd; ++w)
+	{
+		for(bits = *w; bits != 0; bits &= bits - 1)
+		{
+			snp = (w - wordsBegin)*64 + lowestBit(bits);
+
+			if(chromosome.noIncluded == 0) chromosome.firstIncludedGeneDis = geneDis[snp];
+			else chromosome.gapStats.add(geneDis[snp] - chromosome.lastIncludedGeneDis);
+
+			chromosome.lastIncludedGeneDis = geneDis[snp];
+			chromosome.noIncluded++;
+		};
+	};
+};
+
+//! Marks which SNPs are to be included in final file 
+void SNPThinner::includeSNPsForFinal(Chromosome & chromosome)
+{
+	//cout << snpsPerCM << " p final\n";
+	double geneDisStep = getGeneDisStep(snpsPerCM);
+	const double * geneDis = &geneticDistances[chromosome.firstSNP];
+
+	if(!snpScores.empty())
+	{
+		includeSNPsForFinalScored(chromosome, geneDisStep);
+		return;
+	};
+
+	//when few SNPs are kept from sorted positions, go straight to the SNPs around each marker
+	if(useSparseKernel(chromosome, geneDisStep))
+	{
+		includeSNPsForFinalSparse(chromosome, geneDisStep);
+		return;
+	};
+
+	double marker = geneDis[0] + geneDisStep;
+	double prevIncludeGeneDis = geneDis[0];
+
+	size_t i = 0;
+	
+	//include the first SNP
+	setIncluded(chromosome, i);
+	 ++i;
+
+	if(i == chromosome.noSNPs) return;
+
+	size_t prevSNP = i;
+
+	do{
+
+		//pick a SNP to include
+		if(geneDis[i] > marker)
+		{
+			//pick closest SNP to marker or second if first is already chosen
+			if((geneDis[i] - marker) <  (marker - geneDis[prevSNP]) || isIncluded(chromosome, prevSNP) )
+			{
+				if(geneDis[i] != prevIncludeGeneDis) setIncluded(chromosome, i);
+				prevIncludeGeneDis = geneDis[i];
+			}
+			else
+			{
+				if(geneDis[prevSNP] != prevIncludeGeneDis) setIncluded(chromosome, prevSNP);
+				prevIncludeGeneDis = geneDis[prevSNP];
+			};
+
+			//move on marker past the geneDis of the last included SNP
+			do{ marker += geneDisStep; }while(marker <= prevIncludeGeneDis);
+		};
+
+		prevSNP = i;
+		++i;
+	}while(i != chromosome.noSNPs);
+
+
+};
+
+//! Returns whether a chromosome is thinned with the sparse kernel, which is when its positions are sorted and few SNPs are expected to be kept.
+bool SNPThinner::useSparseKernel(const Chromosome & chromosome, const double & geneDisStep) const
+{
+	if(!chromosome.sorted || chromosome.noSNPs < 2) return false;
+
+	const double * geneDis = &geneticDistances[chromosome.firstSNP];
+
+	return (geneDis[chromosome.noSNPs - 1] - geneDis[0])/geneDisStep*sparseThinningRatio < chromosome.noSNPs;
+};
+
+//! Marks the same SNPs as includeSNPsForFinal for a chromosome with sorted positions. Only the first SNP after each marker
+//! changes which SNPs are included, so it is found with a search and the time taken depends on the number of SNPs kept.
+void SNPThinner::includeSNPsForFinalSparse(Chromosome & chromosome, const double & geneDisStep)
+{
+	const double * geneDis = &geneticDistances[chromosome.firstSNP];
+	const double * geneDisEnd = geneDis + chromosome.noSNPs;
+
+	double marker = geneDis[0] + geneDisStep;
+	double prevIncludeGeneDis = geneDis[0];
+
+	//include the first SNP
+	size_t i = 0;
+	size_t lastIncluded = i;
+	setIncluded(chromosome, i);
+
+	while(true)
+	{
+		i = findFirstAfter(geneDis + i + 1, geneDisEnd, marker) - geneDis;
+		if(i == chromosome.noSNPs) return;
+
+		//pick closest SNP to marker or second if first is already chosen
+		if((geneDis[i] - marker) < (marker - geneDis[i - 1]) || lastIncluded == i - 1)
+		{
+			if(geneDis[i] != prevIncludeGeneDis)
+			{
+				setIncluded(chromosome, i);
+				lastIncluded = i;
+			};
+			prevIncludeGeneDis = geneDis[i];
+		}
+		else
+		{
+			if(geneDis[i - 1] != prevIncludeGeneDis)
+			{
+				setIncluded(chromosome, i - 1);
+				lastIncluded = i - 1;
+			};
+			prevIncludeGeneDis = geneDis[i - 1];
+		};
+
+		//move on marker past the geneDis of the last included SNP
+		do{ marker += geneDisStep; }while(marker <= prevIncludeGeneDis);
+	};
+};
+
+//! Marks which SNPs are to be included in the final file when the SNPs have scores, preferring SNPs with higher scores near each marker.
+void SNPThinner::includeSNPsForFinalScored(Chromosome & chromosome, const double & geneDisStep)
+{
+	walkScoredSNPs(&geneticDistances[chromosome.firstSNP], &snpScores[chromosome.firstSNP], chromosome.noSNPs, geneDisStep, getScoreWindow(geneDisStep),
+		[&](const size_t & snp) { setIncluded(chromosome, snp); });
+};
+
+//! Counts the SNPs that includeSNPsForFinal would include, and finds the range of steps between markers that include the same SNPs.
+StepRangeCount SNPThinner::countSNPsForFinal(const Chromosome & chromosome, const double & geneDisStep) const
+{
+	StepRangeCount range(geneDisStep);
+
+	if(chromosome.noSNPs == 0) return range;
+
+	//with scores the range of steps keeping the same SNPs is not found, so only the step tried is known to keep them
+	if(!snpScores.empty())
+	{
+		const double * geneDis = &geneticDistances[chromosome.firstSNP];
+		double largestGeneDis = 0;
+
+		walkScoredSNPs(geneDis, &snpScores[chromosome.firstSNP], chromosome.noSNPs, geneDisStep, getScoreWindow(geneDisStep),
+			[&](const size_t &) { range.count++; });
+
+		for(size_t i = 0; i < chromosome.noSNPs; ++i) largestGeneDis = max(largestGeneDis, fabs(geneDis[i]));
+
+		range.stepLow = range.stepHigh = geneDisStep;
+		range.margin = 16*numeric_limits<double>::epsilon()*(largestGeneDis + geneDisStep);
+
+		return range;
+	};
+
+	const double * snpsBegin = &geneticDistances[chromosome.firstSNP];
+	const double * snpsEnd = snpsBegin + chromosome.noSNPs;
+
+	//each comparison with the marker, firstGeneDis + noSteps*geneDisStep, bounds the steps that make the same choice
+	double firstGeneDis = *snpsBegin;
+	double marker = firstGeneDis + geneDisStep;
+	double noSteps = 1;
+	double stepsBefore;
+	double prevIncludeGeneDis = firstGeneDis;
+	double largestGeneDis = fabs(firstGeneDis);
+	double bound;
+	bool closer, include;
+
+	//include the first SNP
+	range.count = 1;
+
+	const double * i = snpsBegin + 1;
+
+	double prevGeneDis = (i != snpsEnd) ? *i : firstGeneDis;
+	bool prevInclude = false;
+
+	for( ; i != snpsEnd; ++i)
+	{
+		include = false;
+		if(fabs(*i) > largestGeneDis) largestGeneDis = fabs(*i);
+
+		bound = (*i - firstGeneDis)/noSteps;
+
+		if(*i > marker)
+		{
+			if(bound < range.stepHigh) range.stepHigh = bound;
+
+			closer = (*i - marker) < (marker - prevGeneDis);
+
+			//which SNP is closer only matters if the previous SNP is not already included
+			if(!prevInclude)
+			{
+				bound = ((*i + prevGeneDis)*0.5 - firstGeneDis)/noSteps;
+				if(closer)
+				{
+					if(bound > range.stepLow) range.stepLow = bound;
+				}
+				else if(bound < range.stepHigh) range.stepHigh = bound;
+			};
+
+			if(closer || prevInclude)
+			{
+				if(*i != prevIncludeGeneDis)
+				{
+					include = true;
+					range.count++;
+				};
+				prevIncludeGeneDis = *i;
+			}
+			else
+			{
+				if(prevGeneDis != prevIncludeGeneDis)
+				{
+					range.count++;
+					if(i == snpsBegin + 1) include = true; //the previous SNP is this SNP when starting
+				};
+				prevIncludeGeneDis = prevGeneDis;
+			};
+
+			//move on marker past the geneDis of the last included SNP
+			stepsBefore = noSteps;
+			do{ marker += geneDisStep; noSteps++; }while(marker <= prevIncludeGeneDis);
+
+			bound = (prevIncludeGeneDis - firstGeneDis)/noSteps;
+			if(bound > range.stepLow) range.stepLow = bound;
+
+			if(noSteps - 1 > stepsBefore)
+			{
+				bound = (prevIncludeGeneDis - firstGeneDis)/(noSteps - 1);
+				if(bound < range.stepHigh) range.stepHigh = bound;
+			};
+		}
+		else if(bound > range.stepLow) range.stepLow = bound;
+
+		prevGeneDis = *i;
+		prevInclude = include;
+	};
+
+	//the marker is built up by adding steps, so allow for the rounding errors
+	range.margin = 16*numeric_limits<double>::epsilon()*(largestGeneDis + geneDisStep);
+
+	return range;
+};
+
+//! Finds an earlier count of the SNPs kept in a chromosome for a range containing the step, returns false if there is none.
+bool SNPThinner::findCachedCount(const Chromosome & chromosome, const double & geneDisStep, StepRangeCount & range) const
+{
+	for(vector<StepRangeCount>::const_iterator r = chromosome.countCache.begin(); r != chromosome.countCache.end(); ++r)
+	{
+		if(r->contains(geneDisStep))
+		{
+			range = *r;
+			range.step = geneDisStep;
+			return true;
+		};
+	};
+
+	return false;
+};
+
+//! Returns the total numbers of SNPs kept for several steps between markers, and the ranges of steps keeping the same SNPs in every chromosome.
+//! Every chromosome for every step is counted in parallel, reusing earlier counts where possible.
+vector<StepRangeCount> SNPThinner::countThinnedSNPs(const vector<double> & geneDisSteps)
+{
+	runReport.startSearchRound();
+
+	size_t noChromosomes = theChromosomes.size();
+	size_t noSteps = geneDisSteps.size();
+	vector<StepRangeCount> chromosomeCounts(noChromosomes*noSteps);
+	vector<char> counted(noChromosomes*noSteps, 0);
+
+	threadPool.run(noChromosomes*noSteps, [&](size_t t)
+	{
+		const Chromosome & chromosome = theChromosomes[t % noChromosomes];
+		const double & geneDisStep = geneDisSteps[t / noChromosomes];
+
+		if(!findCachedCount(chromosome, geneDisStep, chromosomeCounts[t]))
+		{
+			chromosomeCounts[t] = countSNPsForFinal(chromosome, geneDisStep);
+			counted[t] = 1;
+		};
+	});
+
+	vector<StepRangeCount> counts;
+	StepRangeCount cached;
+
+	for(size_t st = 0; st < noSteps; ++st)
+	{
+		StepRangeCount range(geneDisSteps[st]);
+
+		for(size_t c = 0; c < noChromosomes; ++c)
+		{
+			const StepRangeCount & chromosomeCount = chromosomeCounts[st*noChromosomes + c];
+
+			//keep new counts for later steps, counts with scores are only for the step tried
+			if(counted[st*noChromosomes + c] && snpScores.empty() && !findCachedCount(theChromosomes[c], geneDisSteps[st], cached)) theChromosomes[c].countCache.push_back(chromosomeCount);
+
+			range.count += chromosomeCount.count;
+			if(chromosomeCount.stepLow > range.stepLow) range.stepLow = chromosomeCount.stepLow;
+			if(chromosomeCount.stepHigh < range.stepHigh) range.stepHigh = chromosomeCount.stepHigh;
+			if(chromosomeCount.margin > range.margin) range.margin = chromosomeCount.margin;
+		};
+
+		counts.push_back(range);
+		runReport.addSearchTry(getSNPsPerCMFromStep(range.step), range.count);
+	};
+
+	return counts;
+};
+
+//! Returns the step between markers used to thin the SNPs for a number of SNPs per cM (or per 10^6 bpp).
+double SNPThinner::getGeneDisStep(const double & spc) const
+{
+	double geneDisStep = 1.0/spc;
+
+	if(useBasePairPosition) geneDisStep *= 1000000; //base pair position step is per 1000000 
+
+	return geneDisStep;
+};
+
+//! Returns the SNPs per cM (or per 10^6 bpp) for a step between markers.
+double SNPThinner::getSNPsPerCMFromStep(const double & geneDisStep) const
+{
+	if(useBasePairPosition) return 1000000.0/geneDisStep;
+
+	return 1.0/geneDisStep;
+};
+
+//! Sets the steps beyond which thinning keeps every SNP that can be kept, or only the first SNP of each chromosome.
+void SNPThinner::getGeneDisStepLimits(double & smallestStep, double & largestStep) const
+{
+	double smallestGap = numeric_limits<double>::infinity();
+	double largestRange = 0;
+	double gap;
+
+	for(vector<Chromosome>::const_iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
+	{
+		const double * geneDis = &geneticDistances[c->firstSNP];
+
+		for(size_t i = 0; i < c->noSNPs; ++i)
+		{
+			gap = fabs(geneDis[i] - geneDis[0]);
+			if(gap > largestRange) largestRange = gap;
+
+			if(i != 0)
+			{
+				gap = fabs(geneDis[i] - geneDis[i - 1]);
+				if(gap > 0 && gap < smallestGap) smallestGap = gap;
+			};
+		};
+	};
+
+	if(largestRange == 0) largestRange = 1;
+	if(smallestGap > largestRange) smallestGap = largestRange;
+
+	smallestStep = smallestGap*0.25;
+	largestStep = largestRange*4;
+};
+
+//! Returns the final number of thinned SNPs after a SNP thinning has been done.
+unsigned int SNPThinner::getTotalNoThinnedSNPs() const
+{
+	unsigned int noSNPs = 0;
+	for(vector<Chromosome>::const_iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
+	{
+		noSNPs += c->noIncluded;
+	};
+
+	return noSNPs;
+};
+
+//! Sets the indices of the SNPs kept by the last thinning, in the order the SNPs were added.
+void SNPThinner::getThinnedSNPs(vector<size_t> & thinnedSNPs) const
+{
+	thinnedSNPs.clear();
+	thinnedSNPs.reserve(getTotalNoThinnedSNPs());
+
+	for(vector<Chromosome>::const_iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
+	{
+		for(size_t i = 0; i < c->noSNPs; ++i)
+		{
+			if(isIncluded(*c, i)) thinnedSNPs.push_back(getAddedSNP(c->firstSNP + i));
+		};
+	};
+
+	if(!sortedSNPs.empty()) sort(thinnedSNPs.begin(), thinnedSNPs.end());
+};
+
+//! Sorts the SNPs on chromosome and position, after they have all been added, so that SNPs added out of order are thinned correctly.
+//! The chromosomes are in the order they were first added, each becomes one block however many blocks it was added in, and SNPs
+//! with missing positions go at the end of their chromosome. The SNPs are sorted in memory with a parallel radix sort, or if they
+//! need more than the memory given, in sorted runs spilled to temporary files and merged. Returns false if the files cannot be used.
+bool SNPThinner::sortSNPs(const size_t & memoryBudget)
+{
+	runReport.startPhase("sort");
+
+	vector<string> chromosomeNames;
+	map<string, uint32_t> chromosomeRanks;
+	uint32_t rank;
+
+	SNPSorter sorter(threadPool, memoryBudget);
+	sorter.reserve(totalNoSNPs);
+
+	for(vector<Chromosome>::const_iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
+	{
+		rank = chromosomeRanks.insert(make_pair(c->name, (uint32_t)chromosomeNames.size())).first->second;
+		if(rank == chromosomeNames.size()) chromosomeNames.push_back(c->name);
+
+		for(size_t i = c->firstSNP; i < c->firstSNP + c->noSNPs; ++i) sorter.add(SortRecord(SNPSorter::getPositionKey(geneticDistances[i]), rank, i));
+	};
+
+	sorter.finish();
+
+	//the SNPs are added again in sorted order, the positions are kept in the sort keys
+	vector<uint32_t> prevSortedSNPs;
+	prevSortedSNPs.swap(sortedSNPs);
+	vector<float> prevScores;
+	prevScores.swap(snpScores);
+	vector<double>().swap(geneticDistances);
+	theChromosomes.clear();
+	noMissing = 0;
+	totalNoSNPs = 0;
+	totalCM = 0;
+	foundUnorderedSNP = false;
+
+	SortRecord record;
+	rank = numeric_limits<uint32_t>::max();
+
+	while(sorter.next(record))
+	{
+		if(record.chromosome != rank)
+		{
+			rank = record.chromosome;
+			startChromosome(chromosomeNames[rank], 0);
+		};
+
+		addSNP(SNPSorter::getKeyPosition(record.key));
+		if(!prevScores.empty()) snpScores.push_back(prevScores[record.snp]);
+		sortedSNPs.push_back(prevSortedSNPs.empty() ? record.snp : prevSortedSNPs[record.snp]);
+	};
+
+	setIncludeWords();
+
+	runReport.endPhase();
+
+	return !sorter.hasFailed();
+};
+
+//! Returns the stats of the gaps between the SNPs in the thinned file, and the total of the last genetic distance of each chromosome.
+//! Blocks of a chromosome split up in the map file are taken together, and the chromosomes are taken in order of name.
+GapStats SNPThinner::getFinalGapStats(double & lastGeneDisTotal) const
+{
+	vector<size_t> byName(theChromosomes.size());
+	for(size_t c = 0; c < byName.size(); ++c) byName[c] = c;
+
+	stable_sort(byName.begin(), byName.end(), [this](const size_t & a, const size_t & b) { return theChromosomes[a].name < theChromosomes[b].name; });
+
+	GapStats gapStats;
+	const Chromosome * prevChromosome = 0; //last block with included SNPs
+
+	lastGeneDisTotal = 0;
+
+	for(vector<size_t>::const_iterator b = byName.begin(); b != byName.end(); ++b)
+	{
+		const Chromosome & chromosome = theChromosomes[*b];
+		if(chromosome.noIncluded == 0) continue;
+
+		if(prevChromosome != 0 && chromosome.name == prevChromosome->name)
+		{
+			GapStats blockGap;
+			blockGap.add(chromosome.firstIncludedGeneDis - prevChromosome->lastIncludedGeneDis);
+			gapStats.merge(blockGap);
+		}
+		else if(prevChromosome != 0) lastGeneDisTotal += prevChromosome->lastIncludedGeneDis;
+
+		gapStats.merge(chromosome.gapStats);
+		prevChromosome = &chromosome;
+	};
+
+	if(prevChromosome != 0) lastGeneDisTotal += prevChromosome->lastIncludedGeneDis;
+
+	return gapStats;
+};
+
+//! Returns the stats of the SNPs in the final file, the stats of the gaps were gathered for each chromosome while thinning.
+FinalFileStats SNPThinner::getFinalFileStats() const
+{
+	FinalFileStats stats;
+
+	stats.noSNPs = getTotalNoThinnedSNPs();
+	stats.gapStats = getFinalGapStats(stats.minDis); //minDis starts at an upper bound for the minimum difference
+
+	const GapStats & gapStats = stats.gapStats;
+
+	if(gapStats.noGaps > 0 && gapStats.minGap < stats.minDis) stats.minDis = gapStats.minGap;
+	if(gapStats.noGaps > 0 && gapStats.maxGap > stats.maxDis) stats.maxDis = gapStats.maxGap;
+
+	if(stats.noSNPs >= 2)
+	{
+		stats.mean = gapStats.mean*(double)gapStats.noGaps/((double)(stats.noSNPs - 1));
+		stats.stdev = sqrt(gapStats.getSquaresAbout(stats.mean)/((double)(stats.noSNPs - 1)));
+	};
+
+	stats.median = gapStats.getQuantile(0.5);
+	stats.percentile95 = gapStats.getQuantile(0.95);
+
+	return stats;
+};
+
+//! Sets SNPs per cM based on the total no. of SNPs to keep
+void SNPThinner::setSNPsPerCMFromTotalSNPs(const unsigned int & totalSNPsToKeep)
+{
+	if(totalCM != 0) snpsPerCM = (double)(totalSNPsToKeep)/totalCM;
+};
+
+//! Searches for the SNPs per cM that thins to the total required, and thins the SNPs with it. If the target is not found
+//! the closest number of SNPs found is used.
+//! The number of SNPs kept changes only at the ends of the ranges of steps that keep the same SNPs, so the search
+//! narrows the gap between a range keeping too few SNPs and a range keeping enough until the two ranges meet.
+//! The steps tried do not depend on the number of threads, so neither do the SNPs kept.
+ThinStatus SNPThinner::thinToTargetNoSNPs(const unsigned int & targetThinnedSNPs)
+{
+	search = true;
+	searchTarget = targetThinnedSNPs;
+
+	if(!(targetThinnedSNPs < totalNoSNPs && targetThinnedSNPs > 0)) return thinBadTarget;
+	if(targetThinnedSNPs > totalNoSNPs - noMissing) return thinTooManyMissing;
+
+	runReport.startPhase("search");
+
+	double smallestStep, largestStep;
+	getGeneDisStepLimits(smallestStep, largestStep);
+
+	//start with the SNPs per cM that would give the target if the SNPs were evenly spread
+	setSNPsPerCMFromTotalSNPs(targetThinnedSNPs);
+
+	double step = getGeneDisStep(snpsPerCM);
+	if(!(step > smallestStep && step < largestStep)) step = sqrt(smallestStep*largestStep);
+
+	//when finding the ranges either side of the target, try as many halvings or doublings at once as there are threads
+	unsigned int noTriesAtOnce = threadPool.getNoThreads();
+	vector<double> steps(1, step);
+	vector<StepRangeCount> tried = countThinnedSNPs(steps);
+	StepRangeCount below, above; //ranges of steps keeping fewer SNPs than the target, and at least the target
+	bool foundBelow = false;
+	bool foundAbove = false;
+
+	if(tried[0].count < targetThinnedSNPs) { below = tried[0]; foundBelow = true; }
+	else { above = tried[0]; foundAbove = true; };
+
+	//find ranges either side of the target by halving or doubling the step
+	while(!foundAbove && step > smallestStep)
+	{
+		steps.clear();
+		do{ step *= 0.5; steps.push_back(step); }while(steps.size() < noTriesAtOnce && step > smallestStep);
+
+		tried = countThinnedSNPs(steps);
+
+		for(vector<StepRangeCount>::const_iterator t = tried.begin(); t != tried.end(); ++t)
+		{
+			if(t->count < targetThinnedSNPs) below = *t;
+			else { above = *t; foundAbove = true; break; };
+		};
+	};
+
+	while(!foundBelow && step < largestStep)
+	{
+		steps.clear();
+		do{ step *= 2; steps.push_back(step); }while(steps.size() < noTriesAtOnce && step < largestStep);
+
+		tried = countThinnedSNPs(steps);
+
+		for(vector<StepRangeCount>::const_iterator t = tried.begin(); t != tried.end(); ++t)
+		{
+			if(t->count < targetThinnedSNPs) { below = *t; foundBelow = true; break; }
+			else above = *t;
+		};
+	};
+
+	//narrow the gap between the ranges, smaller steps keep more SNPs
+	if(foundBelow && foundAbove)
+	{
+		double gapLow, gapHigh, prevGap = 0, trySNPsPerCM, lowSNPsPerCM, highSNPsPerCM;
+		unsigned int noRounds = 0;
+
+		while(noRounds < 200)
+		{
+			gapLow = above.stepHigh;
+			gapHigh = below.stepLow;
+			if(gapHigh - gapLow <= 2*(above.margin + below.margin)) break;
+
+			//with scores the ends of the ranges are not known, so stop at the first step keeping the target
+			if(!snpScores.empty() && above.count == targetThinnedSNPs) break;
+
+			//interpolate on the number of SNPs, or halve the gap if the last try did not make it much smaller
+			lowSNPsPerCM = getSNPsPerCMFromStep(gapHigh);
+			highSNPsPerCM = getSNPsPerCMFromStep(gapLow);
+			trySNPsPerCM = lowSNPsPerCM + (highSNPsPerCM - lowSNPsPerCM)*((targetThinnedSNPs - 0.5) - below.count)/(double)(above.count - below.count);
+			step = getGeneDisStep(trySNPsPerCM);
+
+			if(prevGap != 0 && (gapHigh - gapLow) > 0.5*prevGap) step = (gapLow + gapHigh)*0.5;
+			if(!(step > gapLow + 0.01*(gapHigh - gapLow) && step < gapHigh - 0.01*(gapHigh - gapLow))) step = (gapLow + gapHigh)*0.5;
+
+			//each try depends on the one before, so one step is tried at a time with its chromosomes counted in parallel
+			steps.assign(1, step);
+
+			prevGap = gapHigh - gapLow;
+			tried = countThinnedSNPs(steps);
+			++noRounds;
+
+			if(tried[0].count < targetThinnedSNPs) below = tried[0];
+			else above = tried[0];
+		};
+
+		//the number of SNPs kept does not always rise as the step falls, so if the ranges meet without keeping the target
+		//try the next few ranges either side of the gap for one that does, or is closer to it
+		StepRangeCount nextAbove = above, nextBelow = below;
+		bool tryAbove, tryBelow;
+
+		for(unsigned int r = 0; r < 16 && above.count != targetThinnedSNPs && snpScores.empty(); ++r)
+		{
+			tryAbove = nextAbove.stepLow - 2*nextAbove.margin > smallestStep;
+			tryBelow = nextBelow.stepHigh + 2*nextBelow.margin < largestStep;
+			if(!tryAbove && !tryBelow) break;
+
+			steps.clear();
+			if(tryAbove) steps.push_back(nextAbove.stepLow - 2*nextAbove.margin);
+			if(tryBelow) steps.push_back(nextBelow.stepHigh + 2*nextBelow.margin);
+
+			tried = countThinnedSNPs(steps);
+			if(tryAbove) nextAbove = tried.front();
+			if(tryBelow) nextBelow = tried.back();
+
+			for(vector<StepRangeCount>::const_iterator t = tried.begin(); t != tried.end(); ++t)
+			{
+				if(t->count >= targetThinnedSNPs && t->count < above.count) above = *t;
+				else if(t->count < targetThinnedSNPs && t->count > below.count) below = *t;
+			};
+		};
+	};
+
+	//use the middle of the range of steps keeping the target, or the closest number of SNPs if it is not possible to keep the target
+	StepRangeCount best = above;
+	if(!foundAbove || (foundBelow && targetThinnedSNPs - below.count < above.count - targetThinnedSNPs)) best = below;
+
+	searchBelow = below;
+	searchAbove = above;
+	searchBest = best;
+	foundSearchBelow = foundBelow;
+	foundSearchAbove = foundAbove;
+
+
+	step = best.step;
+	if(best.stepHigh != numeric_limits<double>::infinity() && best.stepHigh - best.stepLow > 4*best.margin) step = (best.stepLow + best.stepHigh)*0.5;
+
+	snpsPerCM = getSNPsPerCMFromStep(step);
+
+	return thinSNPs(snpsPerCM);
+};
+
+//! Thins to a target percentage of SNPs
+ThinStatus SNPThinner::thinToTargetPercentNoSNPs(const double & percentToKeep)
+{
+	if(!(percentToKeep > 0 && percentToKeep < 100)) return thinBadPercent;
+
+	unsigned int targetNoSNPs = (unsigned int)((double)(totalNoSNPs)*(percentToKeep*0.01) + 0.5);
+
+	return thinToTargetNoSNPs(targetNoSNPs);
+};
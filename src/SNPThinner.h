@@ -0,0 +1,273 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __SNPTHINNER
+#define __SNPTHINNER
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <stdint.h>
+
+#include "GapStats.h"
+#include "RunReport.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+//! Result of a thinning, errors are returned rather than ending the program so that the SNP thinner may be used as a library.
+enum ThinStatus
+{
+	thinOK,
+	thinBadSNPsPerCM, //the SNPs per cM must not be negative
+	thinBadTarget, //the number of SNPs to keep must be between 0 and the number of SNPs
+	thinBadPercent, //the percentage of SNPs to keep must be between 0 and 100
+	thinTooManyMissing //fewer SNPs have positions than the number to keep
+};
+
+const char * getThinStatusMessage(const ThinStatus & status);
+
+//! Score of a SNP that has none, lower than any score given.
+const float noSNPScore = -numeric_limits<float>::infinity();
+
+//! Class to store the number of SNPs kept by a thinning and the range of steps between markers that keep the same SNPs
+struct StepRangeCount
+{
+	double step; //step between markers that was tried
+	double stepLow, stepHigh; //steps strictly between these keep the same SNPs
+	double margin; //rounding errors may change the SNPs kept for steps this close to the ends of the range
+	unsigned int count;
+
+	StepRangeCount() : step(0), stepLow(0), stepHigh(0), margin(0), count(0) {};
+	StepRangeCount(const double & st) : step(st), stepLow(0), stepHigh(numeric_limits<double>::infinity()), margin(0), count(0) {};
+
+	~StepRangeCount() {};
+
+	bool contains(const double & st) const {return st > stepLow + margin && st < stepHigh - margin;};
+};
+
+//! Class to store where the SNPs of one chromosome, a block of consecutive lines in the map file, are kept
+struct Chromosome
+{
+	string name;
+	size_t firstSNP; //index of the first SNP of the chromosome in the genetic distances of all SNPs
+	size_t noSNPs;
+	bool sorted; //the positions, including missing positions of 0, never decrease, so may be searched
+	size_t firstIncludeWord; //each chromosome starts a new word of include flags, so chromosomes may be thinned in parallel
+	size_t noIncluded; //number of SNPs of the chromosome in the thinned file
+	double firstIncludedGeneDis, lastIncludedGeneDis;
+	GapStats gapStats; //of the gaps between the SNPs of the chromosome in the thinned file
+	size_t filePosition; //of the first line of the chromosome in the map file
+	vector<StepRangeCount> countCache; //numbers of SNPs kept for the steps tried when searching for a target
+
+	Chromosome(const string & nm, const size_t & fs, const size_t & fp) : name(nm), firstSNP(fs), noSNPs(0), sorted(true), firstIncludeWord(0), noIncluded(0), firstIncludedGeneDis(0), lastIncludedGeneDis(0), gapStats(), filePosition(fp) {};
+
+	~Chromosome() {};
+};
+
+//! Class to store the state of the thinning walk between SNPs, which moves a marker along a chromosome including a SNP next to each marker.
+struct WalkState
+{
+	double marker;
+	double prevIncludeGeneDis;
+	size_t lastIncluded; //the SNP before the marker is not included again if it is the last SNP included
+
+	WalkState() : marker(0), prevIncludeGeneDis(0), lastIncluded(0) {};
+
+	~WalkState() {};
+};
+
+//! Class to store a choice of the thinning walk, made at the first SNP past a marker, and the state of the walk after it.
+struct WalkChoice
+{
+	size_t snp; //first SNP past the marker
+	size_t included; //this SNP or the one before, or none
+	double marker;
+	double prevIncludeGeneDis;
+
+	WalkChoice(const size_t & sn, const size_t & inc, const WalkState & state) : snp(sn), included(inc), marker(state.marker), prevIncludeGeneDis(state.prevIncludeGeneDis) {};
+
+	~WalkChoice() {};
+};
+
+//! Class to store a segment of a large chromosome, thinned from a guessed state of the walk at the same time as the other segments.
+struct ChromosomeSegment
+{
+	size_t chromosome; //index of the chromosome
+	size_t begin, end; //SNPs of the chromosome, segments after the first begin at a new word of include flags
+	vector<WalkChoice> choices; //the first choices made from the guessed state
+	WalkState endState;
+
+	ChromosomeSegment(const size_t & c, const size_t & b, const size_t & e) : chromosome(c), begin(b), end(e), choices(), endState() {};
+
+	~ChromosomeSegment() {};
+};
+
+//! Class to store the stats of the SNPs in the thinned file.
+struct FinalFileStats
+{
+	unsigned int noSNPs;
+	double mean, stdev; //of the gaps between SNPs, divided by the number of SNPs less one
+	double minDis, maxDis;
+	double median, percentile95; //approximate
+	GapStats gapStats;
+
+	FinalFileStats() : noSNPs(0), mean(0), stdev(0), minDis(0), maxDis(0), median(0), percentile95(0), gapStats() {};
+
+	~FinalFileStats() {};
+};
+
+
+//! Class for thinning SNPs given their positions, with no file input or output. The SNPs are added a chromosome at a time in the
+//! order of the positions in each chromosome, or sorted after they are added, and after thinning the indices of the SNPs kept are
+//! in the order the SNPs were added.
+//! Each SNP thinner has its own threads, so several may be used at once.
+class SNPThinner
+{
+protected:
+	double snpsPerCM;
+	bool useBasePairPosition;
+	unsigned int noMissing;
+	unsigned int totalNoSNPs;
+	double totalCM;
+	bool search;
+	unsigned int searchTarget; //number of SNPs searched for
+	bool foundUnorderedSNP;
+	double prevGeneDis; //of the last SNP added with a position, to check the order
+
+	vector<Chromosome> theChromosomes; //blocks of SNPs in the order they were added, reused for every thinning
+	vector<double> geneticDistances; //of every SNP in the order added, in cM (or base pair position), 0 if missing
+	vector<uint64_t> includeSNPs; //bit set for each SNP to include in the thinned file
+	vector<uint32_t> sortedSNPs; //index of each SNP in the order added, if the SNPs have been sorted
+	vector<float> snpScores; //of every SNP in the order added, if the SNPs have scores, noSNPScore if missing
+	double scoreWindow; //SNPs this close to a marker are chosen between on their scores, 0 for half the step between markers
+
+	StepRangeCount searchBelow, searchAbove, searchBest; //ranges found by the last search for a target
+	bool foundSearchBelow, foundSearchAbove;
+
+	ThreadPool threadPool; //chromosomes are thinned in parallel when there is more than one thread
+
+	RunReport runReport; //times of the phases of the run and the work done
+
+	void thinChromosome(Chromosome & chromosome);
+	void includeSNPsForFinal(Chromosome & chromosome);
+	void thinSegmentFromGuess(ChromosomeSegment & segment, const double & geneDisStep);
+	void walkSNPs(const Chromosome & chromosome, const double & geneDisStep, const size_t & begin, const size_t & end, WalkState & state, vector<WalkChoice> & choices,
+		const size_t & maxNoChoices);
+	size_t meetGuessedChoices(const ChromosomeSegment & segment, const double & geneDisStep, WalkState & state, vector<WalkChoice> & choices) const;
+	void joinSegments(const vector<ChromosomeSegment>::const_iterator & firstSegment, const vector<ChromosomeSegment>::const_iterator & lastSegment,
+		const double & geneDisStep);
+	void addIncludedGapStats(Chromosome & chromosome);
+	bool useSparseKernel(const Chromosome & chromosome, const double & geneDisStep) const;
+	void includeSNPsForFinalSparse(Chromosome & chromosome, const double & geneDisStep);
+	void includeSNPsForFinalScored(Chromosome & chromosome, const double & geneDisStep);
+	double getScoreWindow(const double & geneDisStep) const {return scoreWindow > 0 ? scoreWindow : 0.5*geneDisStep;};
+	StepRangeCount countSNPsForFinal(const Chromosome & chromosome, const double & geneDisStep) const;
+	bool isIncluded(const Chromosome & chromosome, const size_t & snp) const {return (includeSNPs[chromosome.firstIncludeWord + (snp >> 6)] >> (snp & 63)) & 1;};
+	void setIncluded(const Chromosome & chromosome, const size_t & snp) {includeSNPs[chromosome.firstIncludeWord + (snp >> 6)] |= (uint64_t)1 << (snp & 63);};
+	void clearIncluded(const Chromosome & chromosome, const size_t & snp) {includeSNPs[chromosome.firstIncludeWord + (snp >> 6)] &= ~((uint64_t)1 << (snp & 63));};
+	void clearIncludeWords(const Chromosome & chromosome, const size_t & begin, const size_t & end) {fill(includeSNPs.begin() + chromosome.firstIncludeWord + begin/64,
+		includeSNPs.begin() + chromosome.firstIncludeWord + (end + 63)/64, 0);};
+	GapStats getFinalGapStats(double & lastGeneDisTotal) const;
+	bool findCachedCount(const Chromosome & chromosome, const double & geneDisStep, StepRangeCount & range) const;
+	vector<StepRangeCount> countThinnedSNPs(const vector<double> & geneDisSteps);
+	double getGeneDisStep(const double & spc) const;
+	double getSNPsPerCMFromStep(const double & geneDisStep) const;
+	void getGeneDisStepLimits(double & smallestStep, double & largestStep) const;
+	void setSNPsPerCMFromTotalSNPs(const unsigned int & totalSNPsToKeep);
+	void startChromosome(const string & name, const size_t & filePosition);
+	void addSNP(const double & position);
+	void addSNPScore(const float & score);
+	void setIncludeWords();
+
+public:
+
+	SNPThinner(const bool & ubp, const unsigned int & nt) : snpsPerCM(2.4), useBasePairPosition(ubp), noMissing(0), totalNoSNPs(0), totalCM(0), search(false), searchTarget(0),
+		foundUnorderedSNP(false), prevGeneDis(-1), theChromosomes(), geneticDistances(), includeSNPs(), sortedSNPs(), snpScores(), scoreWindow(0), searchBelow(), searchAbove(), searchBest(), foundSearchBelow(false),
+		foundSearchAbove(false), threadPool(nt), runReport() {};
+
+	virtual ~SNPThinner() {};
+
+	void addChromosome(const string & name, const double * positions, const size_t & noPositions, const float * scores = 0);
+	void setScoreWindow(const double & sw) {scoreWindow = sw;};
+	bool hasScores() const {return !snpScores.empty();};
+	size_t getNoScoredSNPs() const {return snpScores.size() - count(snpScores.begin(), snpScores.end(), noSNPScore);};
+	ThinStatus thinSNPs(const double & spc);
+	ThinStatus thinToTargetNoSNPs(const unsigned int & targetThinnedSNPs);
+	ThinStatus thinToTargetPercentNoSNPs(const double & percentToKeep);
+	bool sortSNPs(const size_t & memoryBudget);
+	void getThinnedSNPs(vector<size_t> & thinnedSNPs) const;
+	bool isSorted() const {return !sortedSNPs.empty();};
+	size_t getAddedSNP(const size_t & snp) const {return sortedSNPs.empty() ? snp : sortedSNPs[snp];}; //index in the order added of a SNP
+	unsigned int getTotalNoThinnedSNPs() const;
+	FinalFileStats getFinalFileStats() const;
+	unsigned int getTotalNoSNPs() const {return totalNoSNPs;};
+	unsigned int getNoMissing() const {return noMissing;};
+	double getSNPsPerCM() const {return snpsPerCM;};
+	bool hasUnorderedSNPs() const {return foundUnorderedSNP;};
+	const vector<Chromosome> & getChromosomes() const {return theChromosomes;};
+	const RunReport & getRunReport() const {return runReport;};
+};
+
+//! Adds the next SNP to the chromosome last started, a position of 0 is missing.
+inline void SNPThinner::addSNP(const double & position)
+{
+	Chromosome & chromosome = theChromosomes.back();
+
+	//the total distance used to start a search adds the last distance of each chromosome, or the first base pair position of the next
+	if(chromosome.noSNPs == 0 && theChromosomes.size() > 1)
+	{
+		if(useBasePairPosition) totalCM += position;
+		else if(!geneticDistances.empty()) totalCM += geneticDistances.back();
+	};
+
+	//the first SNP is compared with -infinity so that a position that is not a number is never sorted
+	double prevPosition = chromosome.noSNPs == 0 ? -numeric_limits<double>::infinity() : geneticDistances.back();
+	if(!(position >= prevPosition)) chromosome.sorted = false;
+
+	if(position == 0) noMissing++;
+	else
+	{
+		if(position < prevGeneDis) foundUnorderedSNP = true;
+		prevGeneDis = position;
+	};
+
+	geneticDistances.push_back(position);
+	chromosome.noSNPs++;
+	totalNoSNPs++;
+};
+
+//! Sets the score of the SNP last added, such as its MAF or INFO, SNPs with higher scores are preferred when thinning. SNPs added
+//! before the first score is set have no score.
+inline void SNPThinner::addSNPScore(const float & score)
+{
+	snpScores.resize(geneticDistances.size() - 1, noSNPScore);
+	snpScores.push_back(score);
+};
+
+#endif
@@ -0,0 +1,132 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#include "ScoreIndex.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+//! Returns whether a character separates the fields of a line of the score file.
+static inline bool isSeparator(const char & c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+};
+
+//! Number of IDs of the score file waiting to be added to the hash table, the slot of each is fetched from memory while the lines after it are read.
+static const size_t noPendingScores = 16;
+
+//! Starts fetching a slot of the hash table from memory, to be used a little later.
+static inline void prefetchSlot(const ScoreSlot * slot)
+{
+#if defined(__GNUC__)
+	__builtin_prefetch(slot, 1);
+#endif
+};
+
+//! Adds the score of a SNP ID, returns false if the ID has already been added.
+bool ScoreIndex::insert(const PendingScore & pending)
+{
+	uint32_t tag = pending.hash >> 32;
+	const char * data = readScores.getData();
+	size_t s = pending.hash & mask;
+
+	for( ; !slots[s].isEmpty(); s = (s + 1) & mask)
+	{
+		if(slots[s].tag == tag && slots[s].getIdLength() == pending.length && memcmp(data + slots[s].getIdPosition(), pending.id, pending.length) == 0) return false;
+	};
+
+	slots[s].idPositionLength = ((uint64_t)(pending.id - data) << 16) | pending.length;
+	slots[s].tag = tag;
+	slots[s].score = pending.score;
+	noScores++;
+
+	return true;
+};
+
+//! Reads the score file, which may be gzipped, and adds the score of each SNP ID to the hash table. Returns false if it cannot be read.
+bool ScoreIndex::read(const string & filename, ThreadPool * threadPool)
+{
+	readScores.open(filename, false, false, threadPool);
+	if(!readScores.isOpen()) return false;
+
+	const char * data = readScores.getData();
+	const char * end = data + readScores.getSize();
+
+	//the table has at least half as many slots again as there are lines, so that it is at most two thirds full
+	size_t noLines = count(data, end, '\n') + 1;
+	size_t noSlots = 1024;
+	while(noSlots < noLines + noLines/2) noSlots *= 2;
+
+	slots.assign(noSlots, ScoreSlot());
+	mask = noSlots - 1;
+	noScores = 0;
+
+	const char * lineEnd;
+	const char * id;
+	const char * scoreStart;
+	size_t idLength;
+
+	//the IDs are added in the order of the lines, each a few lines after its slot is prefetched
+	PendingScore pending[noPendingScores];
+	size_t noPending = 0;
+
+	for(const char * c = data; c < end; c = lineEnd + 1)
+	{
+		lineEnd = (const char *)memchr(c, '\n', end - c);
+		if(lineEnd == 0) lineEnd = end;
+
+		while(c != lineEnd && isSeparator(*c)) ++c;
+		id = c;
+		while(c != lineEnd && !isSeparator(*c)) ++c;
+		idLength = c - id;
+
+		while(c != lineEnd && isSeparator(*c)) ++c;
+		scoreStart = c;
+		while(c != lineEnd && !isSeparator(*c)) ++c;
+
+		//lines without a number for the score are skipped
+		if(idLength == 0 || idLength > 0xffff || scoreStart == c || !(isdigit(*scoreStart) || *scoreStart == '-' || *scoreStart == '+' || *scoreStart == '.')) continue;
+
+		PendingScore & next = pending[noPending % noPendingScores];
+		if(noPending >= noPendingScores) insert(next);
+
+		next.id = id;
+		next.length = idLength;
+		next.hash = hashID(id, idLength);
+		next.score = (float)FieldView(scoreStart, c - scoreStart).toDouble();
+		prefetchSlot(&slots[next.hash & mask]);
+		noPending++;
+	};
+
+	for(size_t p = noPending > noPendingScores ? noPending - noPendingScores : 0; p < noPending; ++p) insert(pending[p % noPendingScores]);
+
+	return true;
+};
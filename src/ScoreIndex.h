@@ -0,0 +1,151 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __SCOREINDEX
+#define __SCOREINDEX
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+#include "MapFileReader.h"
+
+using namespace std;
+
+//! Class to store one SNP of the score file in the hash table, the SNP ID is not copied but kept as where it is in the score file.
+//! Each slot is 16 bytes, so that four share a cache line.
+struct ScoreSlot
+{
+	uint64_t idPositionLength; //position of the ID in the score file shifted up 16 bits, and its length in the low 16 bits, 0 if the slot is empty
+	uint32_t tag; //high bits of the hash of the ID, to skip most other IDs without comparing them
+	float score;
+
+	ScoreSlot() : idPositionLength(0), tag(0), score(0) {};
+
+	~ScoreSlot() {};
+
+	bool isEmpty() const {return idPositionLength == 0;};
+	size_t getIdPosition() const {return idPositionLength >> 16;};
+	size_t getIdLength() const {return idPositionLength & 0xffff;};
+};
+
+//! Class to store an ID of the score file waiting to be added to the hash table while its slot is fetched from memory.
+struct PendingScore
+{
+	const char * id;
+	size_t length;
+	uint64_t hash;
+	float score;
+
+	PendingScore() : id(0), length(0), hash(0), score(0) {};
+
+	~PendingScore() {};
+};
+
+//! Class for looking up the score of a SNP, such as its MAF or INFO, by its ID. The score file has an ID and a score on each line,
+//! and is kept in memory while the IDs are found in an open addressing hash table with linear probing. Lines that do not have a
+//! number for the score, such as a header line, are skipped, and if an ID is given more than once the first score is used. IDs longer
+//! than 65535 characters are skipped.
+class ScoreIndex
+{
+private:
+	MapFileReader readScores; //the IDs in the hash table point into the data of the score file
+	vector<ScoreSlot> slots; //a power of two, at most two thirds full
+	size_t mask;
+	size_t noScores;
+
+	static uint64_t hashID(const char * id, const size_t & length);
+	bool insert(const PendingScore & pending);
+
+public:
+
+	ScoreIndex() : readScores(), slots(), mask(0), noScores(0) {};
+
+	~ScoreIndex() {};
+
+	bool read(const string & filename, ThreadPool * threadPool);
+	bool find(const FieldView & id, float & score) const;
+	size_t getNoScores() const {return noScores;};
+};
+
+//! Returns a hash of the bytes of a SNP ID, taken eight bytes at a time.
+inline uint64_t ScoreIndex::hashID(const char * id, const size_t & length)
+{
+	const uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+	uint64_t hash = length*multiplier;
+	uint64_t word;
+	size_t i = 0;
+
+	for( ; i + 8 <= length; i += 8)
+	{
+		memcpy(&word, id + i, 8);
+		hash = (hash ^ word)*multiplier;
+		hash ^= hash >> 32;
+	};
+
+	if(i < length)
+	{
+		word = 0;
+		memcpy(&word, id + i, length - i);
+		hash = (hash ^ word)*multiplier;
+		hash ^= hash >> 32;
+	};
+
+	//mix the bits so that the low bits used for the slot depend on every byte
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+
+	return hash ^ (hash >> 33);
+};
+
+//! Finds the score of a SNP ID, returns false if it has none.
+inline bool ScoreIndex::find(const FieldView & id, float & score) const
+{
+	if(slots.empty() || id.length == 0) return false;
+
+	uint64_t hash = hashID(id.start, id.length);
+	uint32_t tag = hash >> 32;
+	const char * data = readScores.getData();
+
+	for(size_t s = hash & mask; !slots[s].isEmpty(); s = (s + 1) & mask)
+	{
+		const ScoreSlot & slot = slots[s];
+
+		if(slot.tag == tag && slot.getIdLength() == id.length && memcmp(data + slot.getIdPosition(), id.start, id.length) == 0)
+		{
+			score = slot.score;
+			return true;
+		};
+	};
+
+	return false;
+};
+
+#endif
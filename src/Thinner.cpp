@@ -26,231 +26,533 @@
 #include "Thinner.h"
 #include "main.h"
 
-#include <set>
 #include <string>
 #include <iostream>
 #include <ostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <math.h>
 
 using namespace std;
 
-//! Thin the SNPs.
+//! Thin the SNPs, using the SNP positions read in when the map thinner was created, and write the thinned file.
 void MapThinner::thin()
 {
-	string chromosome, snpIdentifier, geneticDistance, basePairPosition;
-	string alleleName1, alleleName2;
+	ThinStatus status = thinSNPs(snpsPerCM);
 
-	double geneDis;
-	double prevGeneDis = -1;
-	noMissing = 0;
-
-	readMap.open(filename.c_str());
-		
-	if(!readMap.is_open())
+	if(status != thinOK)
 	{
-		cerr<<"Cannot read map file: "<<filename << "!\n";
+		cerr << getThinStatusMessage(status) << "!\n";
 		exit(1);
 	};
 
-	//ensure lists used during thinning are empty
-	for(list<SNP *>::iterator i = theSNPs.begin(); i != theSNPs.end(); ++i)	delete *i;
-	theSNPs.clear();
-	geneticDistancesInFinal.clear();
+	writeThinnedFiles();
+};
 
-	//get first chromosome
-	string prevChromosome;
-	ifstream readMapFirstChromo;
-	readMapFirstChromo.open(filename.c_str());
-	readMapFirstChromo >> prevChromosome;
-	readMapFirstChromo.close();
+//! Writes the thinned file, and the thinned .bed and .fam files if wanted, for the SNPs marked to be kept.
+void MapThinner::writeThinnedFiles()
+{
+	if(writeThinnedFile)
+	{
+		runReport.startPhase("write");
+		runReport.addPass(noBytesRead, totalNoSNPs);
 
-	if(writeThinnedFile) writeMap.open(outputFileName.c_str());
+		//with the line of every SNP known, from sorting or a snapshot, only the lines kept are read
+		bool linesKnown = true;
+		for(vector<InputMapFile *>::const_iterator i = inputs.begin(); i != inputs.end(); ++i) linesKnown = linesKnown && (*i)->snapshot;
 
-	SNP * aSNP;
+		//VCF files are written in order so that the header lines are copied where they are and the file may be decompressed as it is read
+		if(sortSettings.sort || linesKnown) writeSortedSNPs();
+		else if(threadPool.getNoThreads() > 1 && !vcf) writeThinnedSNPsInParallel();
+		else writeThinnedSNPs();
 
-	//read in map data
-	do{
+		if(thinBed)
+		{
+			runReport.startPhase("write bed");
+			writeThinnedBed();
+		};
+	};
 
-		readLineData(readMap, chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);
+	if(outputToScreen && writeThinnedFile)
+	{
+		runReport.startPhase("stats");
+		displayFinalFileStats();
+	};
 
-		if(readMap.eof()) break;
+	runReport.endPhase();
+};
 
-		//process the previous chromosome and then move onto the next
-		if(chromosome != prevChromosome)
-		{
-			thinSNPs(prevChromosome);
-			prevGeneDis = -1;
-		};
+//! Writes the SNPs marked to be included to the thinned file and those with missing positions to the missing file.
+void MapThinner::writeThinnedSNPs()
+{
+	//lines read a piece at a time are gone once the next piece is read, so must be copied
+	bool streaming = false;
+	for(vector<InputMapFile *>::const_iterator i = inputs.begin(); i != inputs.end(); ++i) streaming = streaming || (*i)->readMap.isStreaming();
 
-		if(useBasePairPosition) geneDis = atof(basePairPosition.c_str());
-		else geneDis = atof(geneticDistance.c_str());
+	writeMap.setCopyRanges(streaming);
+	writeMissing.setCopyRanges(streaming);
 
-		aSNP = new SNP(geneDis);
-		if(geneDis == 0)
-		{
-			aSNP->include = false;
-			if(writeThinnedFile) outputMissing(chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);					
-			noMissing++;
-		}
-		else
+	//VCF header lines are only copied from the first map file, unless each map file is thinned to its own file
+	for(size_t f = 0; f < inputs.size(); ++f)
+	{
+		if(f == 0 || splitOutput) openOutputFile(f);
+
+		writeInputSNPs(*inputs[f], f == 0 || splitOutput);
+
+		if(splitOutput) writeMap.close();
+	};
+
+	writeMap.close();
+	writeMissing.close();
+};
+
+//! Writes the lines of the SNPs of one map file marked to be included, with the VCF header lines if wanted.
+void MapThinner::writeInputSNPs(InputMapFile & input, const bool & copyHeaderLines)
+{
+	MapFileReader & readMap = input.readMap;
+	MapLine aLine;
+
+	//the lines of the map file are in the same order as the SNPs
+	readMap.rewind();
+
+	//for a region go straight to the lines of each chromosome, after copying any VCF header lines at the start
+	bool seekChromosomes = region.isSet() && !readMap.isStreaming();
+
+	if(seekChromosomes)
+	{
+		while(readMap.readLine(aLine) && aLine.header)
 		{
-			if(geneDis < prevGeneDis && chromosome == prevChromosome)
-			{
-				foundUnorderedSNP = true;					
-			};
-			prevGeneDis = geneDis;
+			if(copyHeaderLines && !nameOnly) writeLineData(writeMap, aLine);
 		};
+	};
 
-		theSNPs.push_back(aSNP);
+	for(size_t c = input.firstChromosome; c < input.firstChromosome + input.noChromosomes; ++c)
+	{
+		const Chromosome & chromosome = theChromosomes[c];
 
-		prevChromosome = chromosome;
+		if(seekChromosomes) readMap.setPosition(chromosome.filePosition);
 
-	}while(!readMap.eof());
+		for(size_t i = 0; i < chromosome.noSNPs; ++i)
+		{
+			readSNPLine(input, aLine, copyHeaderLines);
 
-	thinSNPs(chromosome);
+			if(writeMissingFile && geneticDistances[chromosome.firstSNP + i] == 0) outputMissing(aLine);
 
-	if(writeThinnedFile) writeMap.close();
-	readMap.close();
-	if(writeThinnedFile && noMissing > 0) writeMissing.close();
+			if(isIncluded(chromosome, i)) writeLineData(writeMap, aLine);
+		};
+	};
 
-	if(outputToScreen && writeThinnedFile) displayFinalFileStats();
+	//copy any VCF header lines after the last SNP, such as when there are no SNPs
+	while(!seekChromosomes && readMap.readLine(aLine))
+	{
+		if(aLine.header && copyHeaderLines && !nameOnly) writeLineData(writeMap, aLine);
+	};
 };
 
-//! Thin SNPs and remove from the list.
-void MapThinner::thinSNPs(string & chromosomeToThin)
+//! Reads the line of the next SNP of a map file, VCF header lines before it are copied to the thinned file if wanted and SNPs not in the region are skipped.
+void MapThinner::readSNPLine(InputMapFile & input, MapLine & aLine, const bool & copyHeaderLines)
 {
-	string chromosome, snpIdentifier, geneticDistance, basePairPosition;
-	string alleleName1, alleleName2;
+	do
+	{
+		if(!input.readMap.readLine(aLine))
+		{
+			cerr << "Cannot read all of map file: " << input.filename << "!\n";
+			exit(1);
+		};
 
-	ifstream readMap2;
-	readMap2.open(filename.c_str());
+		if(aLine.header && copyHeaderLines && !nameOnly) writeLineData(writeMap, aLine);
+	}
+	while(aLine.header || (region.isSet() && !region.contains(aLine)));
+};
+
+//! Writes the thinned file with the lines of several chromosomes prepared at once, the files are written in the original order.
+void MapThinner::writeThinnedSNPsInParallel()
+{
+	size_t noChromosomes = theChromosomes.size();
+	size_t batchSize = threadPool.getNoThreads();
+	vector<LineRanges> thinnedLines(batchSize), missingLines(batchSize);
 
-	if(!readMap2.is_open())
+	//the map file read for each chromosome
+	vector<size_t> chromosomeInputs(noChromosomes);
+	for(size_t f = 0; f < inputs.size(); ++f)
 	{
-		cerr<<"Cannot read map file: "<<filename << "!\n";
-		exit(1);
+		for(size_t c = inputs[f]->firstChromosome; c < inputs[f]->firstChromosome + inputs[f]->noChromosomes; ++c) chromosomeInputs[c] = f;
 	};
 
-	//set which SNPs are to be included in the final file
-	includeSNPsForFinal();
+	size_t outputInput = 0; //the map file being written to its own thinned file, if each is
+	openOutputFile(outputInput);
 
-	//denotes the start of a new chromosome for calculating the final stats
-	list<double> aListGeneDis;
+	for(size_t batchStart = 0; batchStart < noChromosomes; batchStart += batchSize)
+	{
+		size_t noInBatch = batchSize;
+		if(batchStart + noInBatch > noChromosomes) noInBatch = noChromosomes - batchStart;
 
-	//loop thro' map file until at the start of the chromosome to thin current batch of SNPs
-	do{
+		threadPool.run(noInBatch, [&](size_t b)
+		{
+			const Chromosome & chromosome = theChromosomes[batchStart + b];
+			MapLineScanner scanner = inputs[chromosomeInputs[batchStart + b]]->readMap.getScanner(chromosome.filePosition);
+			LineRanges & thinned = thinnedLines[b];
+			LineRanges & missing = missingLines[b];
+			MapLine aLine;
 
-		readLineData(readMap2, chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);
+			thinned.clear();
+			missing.clear();
 
-		if(chromosome == chromosomeToThin) break;
+			for(size_t i = 0; i < chromosome.noSNPs; ++i)
+			{
+				do scanner.readLine(aLine); while(region.isSet() && !region.contains(aLine));
 
-	}while(!readMap2.eof());
+				if(writeMissingFile && geneticDistances[chromosome.firstSNP + i] == 0) writeLineData(missing, aLine);
 
-	//thin SNPs
-	for(list<SNP *>::iterator i = theSNPs.begin(); i != theSNPs.end(); ++i)
-	{
-		//write SNP if it is marked to be included in the final file
-		if((*i)->include)
+				if(isIncluded(chromosome, i)) writeLineData(thinned, aLine);
+			};
+		});
+
+		for(size_t b = 0; b < noInBatch; ++b)
 		{
-			 if(writeThinnedFile)
-			 {					
-					writeLineData(writeMap, chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);
-			 };
+			//map files with no SNPs still have a thinned file written
+			while(splitOutput && outputInput < chromosomeInputs[batchStart + b])
+			{
+				writeMap.close();
+				openOutputFile(++outputInput);
+			};
+
+			writeMap.write(thinnedLines[b]);
 
-			 aListGeneDis.push_back((*i)->geneticDistance);
+			if(!missingLines[b].empty())
+			{
+				if(!writeMissing.isOpen()) openMissingFile();
+				writeMissing.write(missingLines[b]);
+			};
 		};
+	};
 
-		readLineData(readMap2, chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);
+	while(splitOutput && outputInput + 1 < inputs.size())
+	{
+		writeMap.close();
+		openOutputFile(++outputInput);
+	};
+
+	writeMap.close();
+	writeMissing.close();
+};
+
+//! Writes the lines of the SNPs kept, and of those with missing positions, after the SNPs have been sorted or read with snapshots
+//! of the map files. Each line is read from where it is in its map file, so the lines may be written in sorted order or in the order of the map files. VCF header lines are
+//! copied from the start of the map file.
+void MapThinner::writeSortedSNPs()
+{
+	vector<size_t> thinnedSNPs, missingSNPs;
+	getWrittenSNPs(thinnedSNPs, missingSNPs);
+
+	writeMap.setCopyRanges(false);
+	writeMissing.setCopyRanges(false);
 
-		if(readMap2.eof()) break;
+	MapLine aLine;
+	vector<size_t>::const_iterator s = thinnedSNPs.begin();
+
+	for(size_t f = 0; f < inputs.size(); ++f)
+	{
+		if(f != 0 && !splitOutput) break;
+
+		openOutputFile(f);
+
+		if(!nameOnly)
+		{
+			MapLineScanner scanner = inputs[f]->readMap.getScanner(0);
+			while(scanner.readLine(aLine) && aLine.header) writeLineData(writeMap, aLine);
+		};
+
+		for( ; s != thinnedSNPs.end() && (!splitOutput || getInputOfSNP(*s) == f); ++s) writeSNPLine(writeMap, *s);
+
+		writeMap.close();
 	};
 
-	//add distances for this chromosome to list of genetic distances
-	geneticDistancesInFinal[chromosomeToThin] = aListGeneDis;
+	if(writeMissingFile)
+	{
+		for(vector<size_t>::const_iterator m = missingSNPs.begin(); m != missingSNPs.end(); ++m)
+		{
+			if(!writeMissing.isOpen()) openMissingFile();
+			writeSNPLine(writeMissing, *m);
+		};
+	};
+
+	writeMissing.close();
+};
+
+//! Sets the SNPs kept and the SNPs with missing positions, by their index in the order of the map files, in the order their lines
+//! are written. This is the sorted order unless the order of the map files is kept, with the SNPs of each map file together if each
+//! map file has its own thinned file.
+void MapThinner::getWrittenSNPs(vector<size_t> & thinnedSNPs, vector<size_t> & missingSNPs) const
+{
+	thinnedSNPs.clear();
+	missingSNPs.clear();
+	thinnedSNPs.reserve(getTotalNoThinnedSNPs());
 
-	//delete and then empty the list
-	for(list<SNP *>::iterator i = theSNPs.begin(); i != theSNPs.end(); ++i)
+	for(vector<Chromosome>::const_iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
 	{
-		delete *i;
+		for(size_t i = 0; i < c->noSNPs; ++i)
+		{
+			if(isIncluded(*c, i)) thinnedSNPs.push_back(getAddedSNP(c->firstSNP + i));
+			if(geneticDistances[c->firstSNP + i] == 0) missingSNPs.push_back(getAddedSNP(c->firstSNP + i));
+		};
 	};
 
-	theSNPs.clear();
+	if(sortSettings.keepOrder)
+	{
+		sort(thinnedSNPs.begin(), thinnedSNPs.end());
+		sort(missingSNPs.begin(), missingSNPs.end());
+	}
+	else if(splitOutput) stable_sort(thinnedSNPs.begin(), thinnedSNPs.end(), [this](const size_t & a, const size_t & b) { return getInputOfSNP(a) < getInputOfSNP(b); });
 };
 
-//! Outputs SNPs with missing genetic distance.
-void MapThinner::outputMissing(string & chromosome, string & snpIdentifier, string & geneticDistance, string & basePairPosition, string & alleleName1, string & alleleName2)
+//! Returns the map file of a SNP, given by its index in the order of the map files.
+size_t MapThinner::getInputOfSNP(const size_t & snp) const
 {
-	if(noMissing == 0)
+	size_t low = 0, high = inputs.size(), middle;
+
+	//map files with no SNPs have the same first SNP as the next map file
+	while(high - low > 1)
 	{
-		string missingFileName = "missingGeneticDis.txt";
-		if(useBasePairPosition) missingFileName = "missingBasePairPosition.txt";
-		writeMissing.open(missingFileName.c_str());
+		middle = (low + high)/2;
+		if(inputs[middle]->firstSNP <= snp) low = middle;
+		else high = middle;
 	};
 
-	writeLineData(writeMissing, chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);
+	return low;
 };
 
-//! Marks which SNPs are to be included in final file 
-void MapThinner::includeSNPsForFinal()
+//! Writes the line of a SNP, given by its index in the order of the map files, reading it from where it is in its map file.
+void MapThinner::writeSNPLine(LineSink & writeMapFile, const size_t & snp)
 {
-	//cout << snpsPerCM << " p final\n";
-	double geneDisStep = 1.0/snpsPerCM;
+	const InputMapFile & input = *inputs[getInputOfSNP(snp)];
+	MapLineScanner scanner = input.readMap.getScanner(input.linePositions[snp - input.firstSNP]);
+	MapLine aLine;
 
-	if(useBasePairPosition) geneDisStep *= 1000000; //base pair position step is per 1000000 
+	scanner.readLine(aLine);
+	writeLineData(writeMapFile, aLine);
+};
 
-	double marker = (*theSNPs.begin())->geneticDistance + geneDisStep;
-	double prevIncludeGeneDis = (*theSNPs.begin())->geneticDistance;
+//! Returns the name of the file for SNPs with missing genetic distances (or base pair positions), compressed if the output is.
+string MapThinner::getMissingFileName() const
+{
+	string missingFileName = "missingGeneticDis.txt";
+	if(useBasePairPosition) missingFileName = "missingBasePairPosition.txt";
+	if(compressOutput) missingFileName += ".gz";
 
-	list<SNP *>::iterator i = theSNPs.begin();
-	
-	//include the first SNP
-	(*i)->include = true;
-	 ++i;
+	return missingFileName;
+};
+
+//! Returns the name of the thinned file for a map file, the output file name with the name of the map file before the file
+//! extension if each map file is thinned to its own file, e.g. out.chr1.bim.
+string MapThinner::getOutputFileName(const size_t & inputNo) const
+{
+	if(!splitOutput) return outputFileName;
+
+	return getTaggedFileName(outputFileName, getFileNameStem(inputs[inputNo]->filename));
+};
+
+//! Opens the thinned file for the lines of a map file.
+void MapThinner::openOutputFile(const size_t & inputNo)
+{
+	writeMap.open(getOutputFileName(inputNo), compressOutput, &threadPool);
+};
+
+//! Returns whether a map file is a .bim file, a .gz or .bgz ending is ignored.
+static bool isBimFileName(const string & filename)
+{
+	string uncompressedName = removeCompressedExtension(filename);
+	unsigned int length = uncompressedName.length();
+
+	if(length < 4) return false;
+
+	string fileExtension = uncompressedName.substr(length-4,4);
+
+	return fileExtension[0] == '.' &&
+		(fileExtension[1] == 'b' || fileExtension[1] == 'B') &&
+		(fileExtension[2] == 'i' || fileExtension[2] == 'I') &&
+		(fileExtension[3] == 'm' || fileExtension[3] == 'M');
+};
+
+//! Returns the name of a .bim file without the .bim ending, and without any .gz or .bgz ending.
+static string getBimPrefix(const string & bimFileName)
+{
+	string prefix = removeCompressedExtension(bimFileName);
+	size_t length = prefix.length();
+
+	if(length >= 4 && (prefix.substr(length-4) == ".bim" || prefix.substr(length-4) == ".BIM")) prefix = prefix.substr(0, length-4);
+
+	return prefix;
+};
+
+//! Sets the .bed and .fam files to be thinned with the .bim files, checking that the files can be thinned.
+void MapThinner::setThinBed()
+{
+	if(!bim)
+	{
+		cerr << "The .bed file can only be thinned with a .bim file, not " << inputs[0]->filename << "!\n";
+		exit(1);
+	};
+
+	if(nameOnly)
+	{
+		cerr << "The .bed file cannot be thinned when writing the SNP names only (-n)!\n";
+		exit(1);
+	};
 
-	SNP * prevSNP = *i;
+	for(size_t f = 0; f < inputs.size(); ++f)
+	{
+		if(getBimPrefix(inputs[f]->filename) == getBimPrefix(getOutputFileName(f)))
+		{
+			cerr << "The thinned .bed file cannot replace the original, use a different output file name to " << inputs[f]->filename << "!\n";
+			exit(1);
+		};
+	};
 
-	do{
+	thinBed = true;
+};
 
-		//pick a SNP to include
-		if((*i)->geneticDistance > marker)
+//! Writes the .bed and .fam files for the thinned .bim files. The genotypes of each kept SNP are copied from the
+//! memory mapped .bed file, and runs of kept SNPs are written in one go. Several .bim files thinned to one file
+//! must have the same .fam file, and their genotypes are written to one .bed file.
+void MapThinner::writeThinnedBed()
+{
+	MapFileWriter writeBed;
+	string famData; //of the first .fam file, as each .bed file must be for the same samples
+
+	//each .bed file is unmapped before the next is read, so the ranges must be written or copied as they are added
+	writeBed.setCopyRanges(!splitOutput && inputs.size() > 1);
+
+	//sorted SNPs are written in the order of the thinned .bim file, which must have the SNPs of each map file together
+	vector<size_t> thinnedSNPs, missingSNPs;
+	vector<size_t>::const_iterator s;
+
+	if(sortSettings.sort)
+	{
+		getWrittenSNPs(thinnedSNPs, missingSNPs);
+
+		for(s = thinnedSNPs.begin(); s != thinnedSNPs.end(); ++s)
 		{
-			//pick closest SNP to marker or second if first is already chosen
-			if(((*i)->geneticDistance - marker) <  (marker - prevSNP->geneticDistance) || prevSNP->include )
+			if(s != thinnedSNPs.begin() && getInputOfSNP(*s) < getInputOfSNP(*(s - 1)))
 			{
-				if((*i)->geneticDistance != prevIncludeGeneDis) (*i)->include = true;
-				prevIncludeGeneDis = (*i)->geneticDistance;
-			}
-			else
-			{
-				if(prevSNP->geneticDistance != prevIncludeGeneDis) prevSNP->include = true;
-				prevIncludeGeneDis = prevSNP->geneticDistance;
+				cerr << "The sorted SNPs of the map files are mixed together, so one .bed file cannot be written, use -keeporder or -split!\n";
+				exit(1);
 			};
+		};
+
+		s = thinnedSNPs.begin();
+	};
 
-			//move on marker past the geneDis of the last included SNP
-			do{ marker += geneDisStep; }while(marker <= prevIncludeGeneDis);
+	for(size_t f = 0; f < inputs.size(); ++f)
+	{
+		const InputMapFile & input = *inputs[f];
+		string inputPrefix = getBimPrefix(input.filename);
+		string outputPrefix = getBimPrefix(getOutputFileName(f));
+		MapFileReader readFam, readBed;
+		MapLine aLine;
+
+		//the number of samples is the number of lines in the .fam file
+		readFam.open(inputPrefix + ".fam", false, false);
+		if(!readFam.isOpen())
+		{
+			cerr << "Cannot read fam file: " << inputPrefix << ".fam!\n";
+			exit(1);
 		};
 
-		prevSNP = *i;
-		++i;
-	}while(i != theSNPs.end());
+		size_t noSamples = 0;
+		while(readFam.readLine(aLine)) noSamples++;
 
+		readBed.open(inputPrefix + ".bed", false, false);
+		if(!readBed.isOpen())
+		{
+			cerr << "Cannot read bed file: " << inputPrefix << ".bed!\n";
+			exit(1);
+		};
 
-};
+		const unsigned char * bed = (const unsigned char *)readBed.getData();
+		size_t snpBlockSize = (noSamples + 3)/4; //2 bits for each sample
 
-//! Returns the final number of thinned SNPs after a SNP thinning has been done.
-unsigned int MapThinner::getTotalNoThinnedSNPs()
-{
-	unsigned int noSNPs = 0;
-	for(map<string, list<double> >::const_iterator c = geneticDistancesInFinal.begin();  c != geneticDistancesInFinal.end(); ++c)
-	{
-		for(list<double>::const_iterator g = c->second.begin(); g != c->second.end(); ++g)
+		if(readBed.getSize() < 3 || bed[0] != 0x6c || bed[1] != 0x1b)
+		{
+			cerr << inputPrefix << ".bed is not a PLINK .bed file!\n";
+			exit(1);
+		};
+
+		if(bed[2] != 1)
 		{
-			noSNPs++;
+			cerr << inputPrefix << ".bed is in individual-major order, only SNP-major .bed files can be thinned!\n";
+			exit(1);
 		};
+
+		if(readBed.getSize() != 3 + input.noFileSNPs*snpBlockSize)
+		{
+			cerr << "The size of " << inputPrefix << ".bed does not match " << input.noFileSNPs << " SNPs and " << noSamples << " samples!\n";
+			exit(1);
+		};
+
+		if(f == 0 || splitOutput)
+		{
+			MapFileWriter writeFam;
+			writeFam.open(outputPrefix + ".fam");
+			writeFam.write(FieldView(readFam.getData(), readFam.getSize()));
+			writeFam.close();
+
+			writeBed.open(outputPrefix + ".bed");
+			writeBed.write(FieldView(readBed.getData(), 3));
+
+			famData.assign(readFam.getData(), readFam.getSize());
+		}
+		else if(famData.compare(0, string::npos, readFam.getData(), readFam.getSize()) != 0)
+		{
+			cerr << "The .fam files must be the same to thin to one .bed file, " << inputPrefix << ".fam is not the same as " << getBimPrefix(inputs[0]->filename) << ".fam!\n";
+			exit(1);
+		};
+
+		//the SNPs of the .bed file are in the same order as the lines of the .bim file
+		size_t fileSNP;
+
+		for( ; sortSettings.sort && s != thinnedSNPs.end() && getInputOfSNP(*s) == f; ++s)
+		{
+			fileSNP = *s - input.firstSNP;
+			if(region.isSet()) fileSNP = input.fileSNPs[fileSNP];
+
+			writeBed.write(FieldView(readBed.getData() + 3 + fileSNP*snpBlockSize, snpBlockSize));
+		};
+
+		for(size_t c = input.firstChromosome; c < input.firstChromosome + input.noChromosomes && !sortSettings.sort; ++c)
+		{
+			const Chromosome & chromosome = theChromosomes[c];
+
+			for(size_t i = 0; i < chromosome.noSNPs; ++i)
+			{
+				if(!isIncluded(chromosome, i)) continue;
+
+				fileSNP = chromosome.firstSNP + i - input.firstSNP;
+				if(region.isSet()) fileSNP = input.fileSNPs[fileSNP];
+
+				writeBed.write(FieldView(readBed.getData() + 3 + fileSNP*snpBlockSize, snpBlockSize));
+			};
+		};
+
+		//the last ranges are written before the .bed file is unmapped
+		if(splitOutput || f + 1 == inputs.size()) writeBed.close();
 	};
+};
 
-	return noSNPs;
+//! Opens the file for SNPs with missing genetic distances (or base pair positions).
+void MapThinner::openMissingFile()
+{
+	writeMissing.open(getMissingFileName(), compressOutput, &threadPool);
+};
+
+//! Outputs SNPs with missing genetic distance.
+void MapThinner::outputMissing(const MapLine & aLine)
+{
+	if(!writeMissing.isOpen()) openMissingFile();
+
+	writeLineData(writeMissing, aLine);
 };
 
 //! Display stats SNPs with missing genetic distances or base pair positions.
@@ -262,12 +564,12 @@ void MapThinner::displayMissingDataStats()
 			if(useBasePairPosition)
 			{
 				cout << "Number of SNPs with missing base pair positions: "<<noMissing<<"\n";
-				cout <<"\t(Written to file missingBasePairPosition.txt)\n\n";
+				cout <<"\t(Written to file "<<getMissingFileName()<<")\n\n";
 			}
 			else
 			{
 				cout << "Number of SNPs with missing genetic distances: "<<noMissing<<"\n";
-				cout <<"\t(Written to file missingGeneticDis.txt)\n\n";
+				cout <<"\t(Written to file "<<getMissingFileName()<<")\n\n";
 			};
 	};
 
@@ -278,20 +580,24 @@ void MapThinner::displayWarningUnordered()
 {
 	if(foundUnorderedSNP)
 	{
-		if(useBasePairPosition) cout << "Warning: SNPs in \""<<filename<<"\" are not ordered on the base pair position!\n\n";
-		else cout << "Warning: SNPs in \""<<filename<<"\" are not ordered on the genetic distance!\n\n";
+		string mapFiles = "\"" + inputs[0]->filename + "\"";
+		if(inputs.size() > 1) mapFiles = "the map files";
+
+		if(useBasePairPosition) cout << "Warning: SNPs in "<<mapFiles<<" are not ordered on the base pair position, use -sort to sort them!\n\n";
+		else cout << "Warning: SNPs in "<<mapFiles<<" are not ordered on the genetic distance, use -sort to sort them!\n\n";
 	};
 };
 
 //! Display stats of the SNPs in the final file.
 void MapThinner::displayFinalFileStats()
 {
-	//get total number of SNPs
-	unsigned int noSNPs = getTotalNoThinnedSNPs();
+	FinalFileStats stats = getFinalFileStats();
+	unsigned int noSNPs = stats.noSNPs;
 	
 	cout << "Statistics: \n"
 		 << "Total number of SNPs in original file: "<<totalNoSNPs<<"\n"
 	     << "Number of SNPs in thinned file: "<<noSNPs<<" ("<< (100*((double)noSNPs)/((double)totalNoSNPs)) <<"%)\n";
+	if(hasScores()) cout << "Number of SNPs with a score: "<<getNoScoredSNPs()<<"\n";
 
 	displayMissingDataStats();
 
@@ -301,62 +607,12 @@ void MapThinner::displayFinalFileStats()
 			return;
 	};
 
-	double minDis = 0;
-	double maxDis = 0;
-	double mean = 0;
-	double stdev = 0;
-	double prevGD, diff;
-	
-	//set upper bound for minimum difference
-	for(map<string, list<double> >::const_iterator c = geneticDistancesInFinal.begin();  c != geneticDistancesInFinal.end(); ++c)
-	{
-		minDis += *(c->second.rbegin());
-	};
-
-	//now calculate the mean
-	for(map<string, list<double> >::const_iterator ch = geneticDistancesInFinal.begin();  ch != geneticDistancesInFinal.end(); ++ch)
-	{
-		//add stats from each chromosome in turn
-		list<double>::const_iterator gd = ch->second.begin();
-
-		prevGD = *(ch->second.begin());
-		++gd;
-
-		while(gd != ch->second.end())
-		{
-			diff = *gd - prevGD;
-			mean += diff;
-
-			if(diff < minDis) minDis = diff;
-			if(diff > maxDis) maxDis = diff;
-
-			prevGD = *gd;
-			++gd;
-		};
-	};
-
-	mean = mean/((double)(noSNPs - 1));
-
-	//now calculate the standard dev
-	for(map<string, list<double> >::const_iterator ch2 = geneticDistancesInFinal.begin();  ch2 != geneticDistancesInFinal.end(); ++ch2)
-	{
-		//add stats from each chromosome in turn
-		list<double>::const_iterator gd2 = ch2->second.begin();
-
-		prevGD = *(ch2->second.begin());
-		++gd2;
-
-		while(gd2 != ch2->second.end())
-		{
-			diff = *gd2 - prevGD;
-			stdev += (diff - mean)*(diff - mean);
-		
-			prevGD = *gd2;
-			++gd2;
-		};
-	};
-
-	stdev = sqrt(stdev/((double)(noSNPs - 1)));
+	double minDis = stats.minDis;
+	double maxDis = stats.maxDis;
+	double mean = stats.mean;
+	double stdev = stats.stdev;
+	double median = stats.median;
+	double percentile95 = stats.percentile95;
 
 	cout << "\n";
 
@@ -365,6 +621,8 @@ void MapThinner::displayFinalFileStats()
 		if(search) cout << "SNPs per 10^6 base pair position (in file): " << snpsPerCM << "\n";
 		cout << "Mean base pair position (in file) between SNPs: "<<mean<<" bpp\n"
 			 << "St. dev. of base pair position (in file) between SNPs: "<<stdev<<" bpp\n"
+			 << "Median (approx.) base pair position (in file) between SNPs: "<<median<<" bpp\n"
+			 << "95th percentile (approx.) of base pair position (in file) between SNPs: "<<percentile95<<" bpp\n"
 			 << "Range of base pair position (in file) between SNPs: ("<<minDis<<", "<<maxDis<<")\n\n";
 	}
 	else
@@ -372,6 +630,8 @@ void MapThinner::displayFinalFileStats()
 		if(search) cout << "SNPs per cM: " << snpsPerCM << "\n";
 		cout << "Mean genetic distance between SNPs: "<<mean<<" cM\n"
 			 << "St. dev. of genetic distance between SNPs: "<<stdev<<" cM\n"
+			 << "Median (approx.) genetic distance between SNPs: "<<median<<" cM\n"
+			 << "95th percentile (approx.) of genetic distance between SNPs: "<<percentile95<<" cM\n"
 			 << "Range of genetic distances between SNPs: ("<<minDis<<", "<<maxDis<<")\n\n";
 	};
 
@@ -379,123 +639,368 @@ void MapThinner::displayFinalFileStats()
 	
 };
 
-//! Read a line of SNP map file data
-void MapThinner::readLineData(ifstream & readMapFile, string & chromosome, string & snpIdentifier, string & geneticDistance, string & basePairPosition, string & alleleName1, string & alleleName2)
+//! Write a line of SNP map file data, the original bytes of the line are copied
+void MapThinner::writeLineData(LineSink & writeMapFile, const MapLine & aLine)
 {
-	if(bim)
+	static const FieldView newline("\n", 1);
+
+	if(nameOnly)
 	{
-		readMapFile >> chromosome >> snpIdentifier >> geneticDistance >> basePairPosition >> alleleName1 >> alleleName2;
+		writeMapFile.write(aLine.snpIdentifier);
+		writeMapFile.write(newline);
 	}
 	else
 	{
-		readMapFile >> chromosome >> snpIdentifier >> geneticDistance >> basePairPosition;			
+		writeMapFile.write(aLine.line);
+
+		//the last line of the file may not end with a newline
+		if(aLine.line.length == 0 || aLine.line.start[aLine.line.length - 1] != '\n') writeMapFile.write(newline);
 	};
 };
 
-//! Write a line of SNP map file data
-void MapThinner::writeLineData(ofstream & writeMapFile, string & chromosome, string & snpIdentifier, string & geneticDistance, string & basePairPosition, string & alleleName1, string & alleleName2)
+//! Sets whether the map files are .bim files or not (used with binary files), or .vcf files, a .gz or .bgz ending is ignored.
+//! All of the map files must be of the same type.
+void MapThinner::setBim()
 {
-	if(nameOnly)
+	bim = isBimFileName(inputs[0]->filename);
+	vcf = isVCFFileName(inputs[0]->filename);
+
+	for(size_t f = 1; f < inputs.size(); ++f)
 	{
-		writeMapFile << snpIdentifier <<"\n";	
-	}
-	else
+		if(isBimFileName(inputs[f]->filename) != bim || isVCFFileName(inputs[f]->filename) != vcf)
+		{
+			cerr << "The map files must all be of the same type, " << inputs[f]->filename << " is not the same type as " << inputs[0]->filename << "!\n";
+			exit(1);
+		};
+	};
+};
+
+//! Reads the SNP positions from the map files, ending the program if they cannot be read.
+void MapThinner::readSNPs()
+{
+	string error = "";
+	if(scoreSettings.filename != "") error = readScores();
+	if(error == "") error = readMapFiles();
+
+	if(error == "" && sortSettings.sort && !sortSNPs(sortSettings.memoryBudget)) error = "Cannot use temporary files to sort the SNPs";
+
+	if(error != "")
 	{
-		if(bim)
+		cerr << error << "!\n";
+		exit(1);
+	};
+};
+
+//! Reads the scores of the SNP IDs from the score file, to be found for each SNP as it is read. Returns an error if the score
+//! file cannot be read, or an empty string.
+string MapThinner::readScores()
+{
+	runReport.startPhase("scores");
+
+	bool scoresRead = scoreIndex.read(scoreSettings.filename, &threadPool);
+
+	runReport.endPhase();
+
+	if(!scoresRead) return "Cannot read score file " + scoreSettings.filename;
+
+	return "";
+};
+
+//! Reads the SNP positions from the map files and sets the total number of SNPs and the total cM distance. When there is more
+//! than one thread several map files are read at once, then their SNPs are added in the order of the map files.
+//! Returns an error if a map file cannot be read, or an empty string.
+string MapThinner::readMapFiles()
+{
+	runReport.startPhase("read");
+
+	bool readAtOnce = inputs.size() > 1 && threadPool.getNoThreads() > 1;
+
+	if(readAtOnce)
+	{
+		//the threads are busy reading, so compressed map files are decompressed by the thread reading each
+		threadPool.run(inputs.size(), [&](size_t f)
 		{
-			writeMapFile  << chromosome << "\t" << snpIdentifier << "\t" << geneticDistance << "\t" << basePairPosition <<"\t" << alleleName1 <<"\t"<< alleleName2<<"\n";;
-		}
-		else
+			inputs[f]->buffered = true;
+			readMapFile(*inputs[f], 0);
+		});
+
+		size_t noSNPsRead = 0;
+		for(vector<InputMapFile *>::const_iterator i = inputs.begin(); i != inputs.end(); ++i) noSNPsRead += (*i)->positions.size();
+		geneticDistances.reserve(noSNPsRead);
+	};
+
+	noBytesRead = 0;
+
+	for(vector<InputMapFile *>::iterator i = inputs.begin(); i != inputs.end(); ++i)
+	{
+		InputMapFile & input = **i;
+
+		if(!readAtOnce) readMapFile(input, &threadPool);
+
+		if(input.readError != "")
 		{
-			writeMapFile  << chromosome << "\t" << snpIdentifier << "\t" << geneticDistance << "\t" << basePairPosition <<"\n";		
-		};	
+			runReport.endPhase();
+			return input.readError;
+		};
+
+		if(readAtOnce)
+		{
+			addBufferedSNPs(input);
+			input.readMap.setThreadPool(&threadPool);
+		};
+
+		noBytesRead += input.noBytesRead;
 	};
+
+	setIncludeWords();
+
+	runReport.addPass(noBytesRead, totalNoSNPs);
+	runReport.endPhase();
+
+	return "";
 };
 
-//! Sets whether the map file is a .bim file or not (used with binary files)
-void MapThinner::setBim()
+//! Reads the SNPs of one map file, adding them to the thinner or keeping them in the input map file if it is buffered.
+//! Errors are kept in the input map file rather than ending the program, as several map files may be read at once.
+void MapThinner::readMapFile(InputMapFile & input, ThreadPool * decompressThreadPool)
 {
-	unsigned int length = filename.length();
-	string fileExtension;
+	MapFileReader & readMap = input.readMap;
+	MapLine aLine;
+	
+	//the lines of sorted SNPs are read in any order, so compressed VCF files are not streamed
+	readMap.open(input.filename, bim, vcf, decompressThreadPool, !sortSettings.sort);
 
-	if(length >= 4) fileExtension = filename.substr(length-4,4);
-	else return;
+	if(!readMap.isOpen())
+	{
+		input.readError = "Cannot read map file: " + input.filename;
+		return;
+	};
 
-	//determine the type of pedigree file
-	if(fileExtension[0] == '.' &&
-		(fileExtension[1] == 'b' || fileExtension[1] == 'B') &&
-		(fileExtension[2] == 'i' || fileExtension[2] == 'I') &&
-		(fileExtension[3] == 'm' || fileExtension[3] == 'M'))
+	if(!input.buffered)
+	{
+		input.firstChromosome = theChromosomes.size();
+		input.firstSNP = geneticDistances.size();
+	};
+
+	//a region of an uncompressed map file is found using the index of the chromosomes, made the first time it is needed
+	MapFileIndex index;
+	bool useIndex = region.isSet() && !readMap.isCompressed();
+	input.noBytesRead = readMap.getSize();
+
+	//the snapshot of an uncompressed map file is used instead of parsing it, and is made the first time it is needed
+	MapFileSnapshot snapshot;
+	input.snapshot = useSnapshots && !region.isSet() && scoreSettings.filename == "" && !readMap.isCompressed();
+
+	if(input.snapshot && snapshot.read(input.filename, readMap, useBasePairPosition)) readSnapshotSNPs(input, snapshot);
+	else if(useIndex && index.read(input.filename)) readIndexedSNPs(input, index);
+	else
+	{
+		if(useIndex) index.start(input.filename);
+
+		size_t linePosition = readMap.getPosition();
+
+		//reserve enough for the shortest possible lines, memory that is not used is never touched so costs nothing
+		if(!region.isSet())
+		{
+			if(input.buffered) input.positions.reserve(readMap.getSize()/8 + 1);
+			else geneticDistances.reserve(geneticDistances.size() + readMap.getSize()/8 + 1);
+		};
+
+		//the previous line is not kept, as a VCF file may be decompressed a piece at a time
+		while(readMap.readLine(aLine))
+		{
+			if(aLine.header)
+			{
+				linePosition = readMap.getPosition();
+				continue;
+			};
+
+			if(useIndex) index.addSNP(aLine.chromosome, linePosition);
+
+			if(!region.isSet() || region.contains(aLine)) addLineSNP(input, aLine, linePosition);
+
+			input.noFileSNPs++;
+			linePosition = readMap.getPosition();
+		};
+
+		if(readMap.hasFailed())
+		{
+			input.readError = "Cannot read all of map file: " + input.filename;
+			return;
+		};
+
+		if(useIndex) index.write(input.filename);
+		if(input.snapshot) writeSnapshot(input);
+	};
+
+	if(!input.buffered) input.noChromosomes = theChromosomes.size() - input.firstChromosome;
+};
+
+//! Adds the SNPs of a map file that were kept in its buffers to the thinner, then frees the buffers.
+void MapThinner::addBufferedSNPs(InputMapFile & input)
+{
+	input.firstChromosome = theChromosomes.size();
+	input.firstSNP = geneticDistances.size();
+
+	for(vector<Chromosome>::const_iterator c = input.chromosomes.begin(); c != input.chromosomes.end(); ++c)
 	{
-		bim = true;
+		startChromosome(c->name, c->filePosition);
+
+		for(size_t i = 0; i < c->noSNPs; ++i)
+		{
+			addSNP(input.positions[c->firstSNP + i]);
+			if(!input.scores.empty()) addSNPScore(input.scores[c->firstSNP + i]);
+		};
 	};
 
+	input.noChromosomes = input.chromosomes.size();
+	input.buffered = false;
+
+	vector<Chromosome>().swap(input.chromosomes);
+	vector<double>().swap(input.positions);
+	vector<float>().swap(input.scores);
 };
 
-//! Sets the total number of SNPs in original map file and the total cM distance
-void MapThinner::setTotalNoSNPs()
+//! Adds the SNPs of a map file from its snapshot, the map file is not parsed.
+void MapThinner::readSnapshotSNPs(InputMapFile & input, const MapFileSnapshot & snapshot)
 {
-	string chromosome, snpIdentifier, geneticDistance, basePairPosition;
-	string alleleName1, alleleName2;
-	
-	ifstream readMap3;
-	readMap3.open(filename.c_str());
+	const double * positions = snapshot.getPositions();
+	const uint64_t * linePositions = snapshot.getLinePositions();
+	size_t noSNPs = snapshot.getNoSNPs();
+
+	input.readFromSnapshot = true;
+	input.noBytesRead = snapshot.getSnapshotSize();
+	input.noFileSNPs = noSNPs;
+	input.linePositions.assign(linePositions, linePositions + noSNPs);
+
+	if(input.buffered) input.positions.assign(positions, positions + noSNPs);
+	else geneticDistances.reserve(geneticDistances.size() + noSNPs);
 
-	if(!readMap3.is_open())
+	for(size_t b = 0; b < snapshot.getNoBlocks(); ++b)
 	{
-		cerr<<"Cannot read map file: "<<filename << "!\n";
-		exit(1);
+		const SnapshotBlock & block = snapshot.getBlock(b);
+
+		if(input.buffered)
+		{
+			input.chromosomes.push_back(Chromosome(snapshot.getBlockName(b), block.firstSNP, block.filePosition));
+			input.chromosomes.back().noSNPs = block.noSNPs;
+		}
+		else
+		{
+			startChromosome(snapshot.getBlockName(b), block.filePosition);
+			for(size_t i = block.firstSNP; i < block.firstSNP + block.noSNPs; ++i) addSNP(positions[i]);
+		};
 	};
+};
+
+//! Writes the snapshot of the SNPs read from a map file beside it, for the next time the map file is thinned.
+void MapThinner::writeSnapshot(const InputMapFile & input) const
+{
+	if(input.buffered) MapFileSnapshot::write(input.filename, input.readMap, useBasePairPosition, input.chromosomes.data(), input.chromosomes.size(),
+		input.positions.data(), input.linePositions.data(), input.positions.size());
+	else MapFileSnapshot::write(input.filename, input.readMap, useBasePairPosition, theChromosomes.data() + input.firstChromosome,
+		theChromosomes.size() - input.firstChromosome, geneticDistances.data() + input.firstSNP, input.linePositions.data(), geneticDistances.size() - input.firstSNP);
+};
 
-	//get first chromosome
-	string prevChromosome, prevGeneticDistance;
-	ifstream readMapFirstChromo;
-	readMapFirstChromo.open(filename.c_str());
-	readMapFirstChromo >> prevChromosome;
-	readMapFirstChromo.close();
+//! Reads the SNPs in the region from the blocks of the chromosome given by the index, the rest of the map file is not read.
+void MapThinner::readIndexedSNPs(InputMapFile & input, const MapFileIndex & index)
+{
+	MapFileReader & readMap = input.readMap;
+	MapLine aLine;
+	size_t linePosition;
 
-	do{
+	input.noBytesRead = 0;
 
-		readLineData(readMap3, chromosome, snpIdentifier, geneticDistance, basePairPosition, alleleName1, alleleName2);
+	for(vector<IndexBlock>::const_iterator b = index.getBlocks().begin(); b != index.getBlocks().end(); ++b)
+	{
+		if(b->chromosome != region.chromosome) continue;
 
-		if(readMap3.eof()) break;
+		readMap.setPosition(b->filePosition);
+		input.noFileSNPs = b->firstSNP;
 
-		if(chromosome != prevChromosome)
+		for(size_t i = 0; i < b->noSNPs; ++i)
 		{
-			if(useBasePairPosition) totalCM += atof(basePairPosition.c_str());
-			else totalCM += atof(prevGeneticDistance.c_str());
+			do
+			{
+				linePosition = readMap.getPosition();
+
+				if(!readMap.readLine(aLine))
+				{
+					input.readError = "The index " + MapFileIndex::getIndexFileName(input.filename) + " does not match the map file, remove it and try again";
+					return;
+				};
+			}
+			while(aLine.header);
+
+			if(aLine.chromosome != b->chromosome)
+			{
+				input.readError = "The index " + MapFileIndex::getIndexFileName(input.filename) + " does not match the map file, remove it and try again";
+				return;
+			};
+
+			if(region.contains(aLine)) addLineSNP(input, aLine, linePosition);
+
+			input.noFileSNPs++;
 		};
 
-		totalNoSNPs++;
+		input.noBytesRead += readMap.getPosition() - b->filePosition;
+	};
 
-		prevChromosome = chromosome;
-		prevGeneticDistance = geneticDistance;
+	input.noFileSNPs = index.getNoSNPs();
+};
+
+//! Sets the region from chromosome:start-end, the base pair positions are inclusive. Returns false with an error if it is not valid.
+bool MapRegion::parse(const string & regionString, string & error)
+{
+	size_t colon = regionString.find_last_of(':');
+	size_t dash = string::npos;
+	if(colon != string::npos) dash = regionString.find('-', colon + 1);
+
+	if(colon == string::npos || colon == 0 || dash == string::npos || dash == colon + 1 || dash + 1 == regionString.length())
+	{
+		error = "Invalid region, it must be given as chromosome:start-end: " + regionString;
+		return false;
+	};
 
-	}while(!readMap3.eof());
+	chromosome = regionString.substr(0, colon);
+	hasRange = true;
+	start = atof(regionString.substr(colon + 1, dash - colon - 1).c_str());
+	end = atof(regionString.substr(dash + 1).c_str());
 
+	if(!(start >= 0 && start <= end))
+	{
+		error = "Invalid region, the start must not be after the end: " + regionString;
+		return false;
+	};
+
+	return true;
 };
 
-//! Sets SNPs per cM based on the total no. of SNPs to keep
-void MapThinner::setSNPsPerCMFromTotalSNPs(unsigned int & totalSNPsToKeep)
+//! Returns the region as given on the command line, chromosome:start-end.
+string MapRegion::str() const
 {
-	if(totalCM != 0) snpsPerCM = (double)(totalSNPsToKeep)/totalCM;
+	if(!hasRange) return chromosome;
+
+	ostringstream regionString;
+	//base pair positions are written in full, not in scientific notation
+	regionString << chromosome << ":" << fixed << setprecision(0) << start << "-" << end;
+
+	return regionString.str();
 };
 
 
-//! Use a bisection search to thin SNPs to the total required
+//! Thins to the total number of SNPs required and writes the thinned file.
 void MapThinner::thinToTargetNoSNPs(unsigned int & targetThinnedSNPs)
 {
-	search = true;
-	if(!(targetThinnedSNPs < totalNoSNPs && targetThinnedSNPs > 0))
+	ThinStatus status = SNPThinner::thinToTargetNoSNPs(targetThinnedSNPs);
+
+	if(status == thinBadTarget)
 	{
 		cerr << "The number of SNPs to keep must be between 0 and "<<totalNoSNPs<<"!\n";
 		exit(1);
 	};
 
-	setSNPsPerCMFromTotalSNPs(targetThinnedSNPs);
-	pair<double, double> snpsPerCMInterval = getSNPsPerCMInterval(targetThinnedSNPs);
-
-	if((snpsPerCMInterval.first == -1 || snpsPerCMInterval.first == 0) && snpsPerCMInterval.second == 0)
+	if(status == thinTooManyMissing)
 	{
 		cout << "Statistics: \n"
 		     << "Total number of SNPs in original file: "<<totalNoSNPs<<"\n\n";
@@ -503,35 +1008,26 @@ void MapThinner::thinToTargetNoSNPs(unsigned int & targetThinnedSNPs)
 		displayWarningUnordered();
 
 		cerr << "Failed to thin SNPs for these settings!\n\n";
-		if(snpsPerCMInterval.first == -1)
-		{
-			if(useBasePairPosition) cerr << "Consider using genetic distance instead (do not use the -b option)!\n\n";
-			else cerr << "Consider using the base pair position option (-b)!\n\n";
-		};
+		if(useBasePairPosition) cerr << "Consider using genetic distance instead (do not use the -b option)!\n\n";
+		else cerr << "Consider using the base pair position option (-b)!\n\n";
 		exit(1);
 	};
 
-	double trySNPsPerCM;
-	unsigned int nextGuess;
-	unsigned int count = 0;
-
-	do{		
-		//try mid way point as next guess
-		trySNPsPerCM = (snpsPerCMInterval.first + snpsPerCMInterval.second)*0.5;
-
-		nextGuess = tryThinning(trySNPsPerCM);
-
-		if(nextGuess == targetThinnedSNPs || (snpsPerCMInterval.second - snpsPerCMInterval.first) < 1e-6) break;
-		else if(nextGuess > targetThinnedSNPs) snpsPerCMInterval.second = trySNPsPerCM;
-		else snpsPerCMInterval.first = trySNPsPerCM;
-
-		count++;
+	if(status != thinOK)
+	{
+		cerr << getThinStatusMessage(status) << "!\n";
+		exit(1);
+	};
 
-	}while(count < 100);
+	if(searchBest.count != targetThinnedSNPs && outputToScreen)
+	{
+		if(foundSearchBelow && foundSearchAbove) cout << "Could not find a density keeping exactly "<<targetThinnedSNPs<<" SNPs, the closest found keep "<<searchBelow.count<<" and "<<searchAbove.count<<" SNPs.\n\n";
+		else if(foundSearchAbove) cout << "Cannot thin to "<<targetThinnedSNPs<<" SNPs, the fewest possible are "<<searchAbove.count<<" SNPs.\n\n";
+		else cout << "Cannot thin to "<<targetThinnedSNPs<<" SNPs, the most possible are "<<searchBelow.count<<" SNPs.\n\n";
+	};
 
-	//thin SNPs and write to file using the best found SNPs per cM to achieve target no of SNPs
-	writeThinnedFile = true;
-	thin();
+	//write the file thinned with the best found SNPs per cM to achieve target no of SNPs
+	writeThinnedFiles();
 };
 
 //! Thins to a target percentage of SNPs
@@ -541,53 +1037,146 @@ void MapThinner::thinToTargetPercentNoSNPs(double & percentToKeep)
 	thinToTargetNoSNPs(targetNoSNPs);
 };
 
-//! Get an interval for the target number of SNPs
-pair<double, double> MapThinner::getSNPsPerCMInterval(unsigned int & targetThinnedSNPs)
+//! Thins the SNPs several times with different settings, writing a thinned file for each. The map file is read once, and the
+//! counts of SNPs kept for each step found while searching are reused by the following searches.
+void MapThinner::sweep(const vector<SweepSetting> & settings)
 {
-	unsigned int initialGuess = tryThinning(snpsPerCM);
+	sweepSettings = settings;
 
-	if(targetThinnedSNPs > totalNoSNPs - noMissing) return make_pair(-1, 0);
+	for(vector<SweepSetting>::iterator s = sweepSettings.begin(); s != sweepSettings.end(); ++s)
+	{
+		outputFileName = s->outputFileName;
 
-	unsigned int otherGuess;
-	double aBoundsnpsPerCM = snpsPerCM;
-	double otherBound;
-	unsigned int count = 0;
-	double step = 0.5;
-	if(initialGuess > targetThinnedSNPs) step = -0.5;
+		if(outputToScreen) cout << "Thinning with -" << s->option << " " << s->value << " to " << outputFileName << ":\n\n";
 
-	otherBound = aBoundsnpsPerCM;
-	
-	do{
-		otherBound += step;
-		if(otherBound < 0)
+		if(s->option == 't')
 		{
-			otherBound = (otherBound - step)*0.5;
-		};
-
-		otherGuess = tryThinning(otherBound);
-
-		count++;
-
-		if(count > 100) return make_pair(0, 0);//failed to find a bounding interval
+			search = false;
+			snpsPerCM = s->value;
+			thin();
+		}
+		else if(s->option == 's')
+		{
+			unsigned int targetNoSNPs = (unsigned int)s->value;
+			thinToTargetNoSNPs(targetNoSNPs);
+		}
+		else thinToTargetPercentNoSNPs(s->value);
 
-	}while(!((otherGuess < targetThinnedSNPs && initialGuess > targetThinnedSNPs)
-		      || (otherGuess > targetThinnedSNPs && initialGuess <= targetThinnedSNPs)));
+		s->snpsPerCM = snpsPerCM;
+		s->noKept = getTotalNoThinnedSNPs();
 
-	if(otherGuess <= targetThinnedSNPs && initialGuess > targetThinnedSNPs) return make_pair(otherBound, aBoundsnpsPerCM);
-	else return make_pair(aBoundsnpsPerCM, otherBound);
+		//the missing SNPs are the same for every setting
+		writeMissingFile = false;
+	};
 };
 
-//! Trys to thin the SNPs and returns the total number of SNPs in the thinned SNP file.
-unsigned int MapThinner::tryThinning(double & snpsPerCMToTry)
+//! Writes a JSON report of the run, with the times of the phases, the work done, the SNPs kept on each chromosome and the stats of the thinned file.
+void MapThinner::writeReport(const string & reportFileName)
 {
-	//set variables to try a thinning
-	writeThinnedFile = false;
+	ofstream report(reportFileName.c_str());
 
-	//try a thinning with with value for SNP per cM
-	snpsPerCM = snpsPerCMToTry;
-	thin();
+	if(!report.is_open())
+	{
+		cerr << "Cannot write report file: " << reportFileName << "!\n";
+		exit(1);
+	};
 
-	return getTotalNoThinnedSNPs();
-};
+	FinalFileStats stats = getFinalFileStats();
+	const GapStats & gapStats = stats.gapStats;
+	string units = "cM";
+	if(useBasePairPosition) units = "bpp";
+
+	report << "{\n\t\"inputFile\": "; RunReport::writeString(report, inputs[0]->filename);
+	report << ",\n\t\"inputFiles\": [";
+	for(vector<InputMapFile *>::const_iterator i = inputs.begin(); i != inputs.end(); ++i)
+	{
+		if(i != inputs.begin()) report << ", ";
+		RunReport::writeString(report, (*i)->filename);
+	};
+	report << "]";
+	report << ",\n\t\"outputFile\": "; RunReport::writeString(report, outputFileName);
+	report << ",\n\t\"splitOutput\": " << (splitOutput ? "true" : "false");
+	report << ",\n\t\"bim\": " << (bim ? "true" : "false")
+		<< ",\n\t\"vcf\": " << (vcf ? "true" : "false")
+		<< ",\n\t\"region\": ";
+	if(region.isSet()) RunReport::writeString(report, region.str()); else report << "null";
+	report << ",\n\t\"sorted\": " << (isSorted() ? "true" : "false");
+	report << ",\n\t\"scoreFile\": "; if(scoreSettings.filename != "") RunReport::writeString(report, scoreSettings.filename); else report << "null";
+	if(hasScores()) report << ",\n\t\"noScoredSNPs\": " << getNoScoredSNPs();
+	size_t noFromSnapshots = 0;
+	for(vector<InputMapFile *>::const_iterator i = inputs.begin(); i != inputs.end(); ++i) noFromSnapshots += (*i)->readFromSnapshot ? 1 : 0;
+	report << ",\n\t\"snapshots\": " << (useSnapshots ? "true" : "false") << ",\n\t\"noReadFromSnapshots\": " << noFromSnapshots;
+	report << ",\n\t\"namesOnly\": " << (nameOnly ? "true" : "false")
+		<< ",\n\t\"useBasePairPosition\": " << (useBasePairPosition ? "true" : "false")
+		<< ",\n\t\"threads\": " << threadPool.getNoThreads()
+		<< ",\n\t\"snpsPerCM\": "; RunReport::writeNumber(report, snpsPerCM);
+	report << ",\n";
+
+	runReport.writeTimes(report, "\t");
+	report << ",\n";
+
+	if(search) report << "\t\"searchTarget\": " << searchTarget << ",\n";
+	runReport.writeSearch(report, "\t");
+
+	report << ",\n\t\"chromosomes\": [";
+	for(vector<Chromosome>::const_iterator c = theChromosomes.begin(); c != theChromosomes.end(); ++c)
+	{
+		report << (c == theChromosomes.begin() ? "\n" : ",\n") << "\t\t{\"name\": ";
+		RunReport::writeString(report, c->name);
+		report << ", \"noSNPs\": " << c->noSNPs << ", \"noKept\": " << c->noIncluded << "}";
+	};
+	report << "\n\t],\n";
 
+	//the statistics that follow are for the last thinning of a sweep
+	if(!sweepSettings.empty())
+	{
+		report << "\t\"sweep\": [";
+		for(vector<SweepSetting>::const_iterator s = sweepSettings.begin(); s != sweepSettings.end(); ++s)
+		{
+			report << (s == sweepSettings.begin() ? "\n" : ",\n") << "\t\t{\"option\": \"" << s->option << "\", \"value\": ";
+			RunReport::writeNumber(report, s->value);
+			report << ", \"outputFile\": ";
+			RunReport::writeString(report, s->outputFileName);
+			report << ", \"snpsPerCM\": ";
+			RunReport::writeNumber(report, s->snpsPerCM);
+			report << ", \"noKept\": " << s->noKept << "}";
+		};
+		report << "\n\t],\n";
+	};
 
+	report << "\t\"statistics\": {\n"
+		<< "\t\t\"units\": \"" << units << "\",\n"
+		<< "\t\t\"noSNPsInOriginalFile\": " << totalNoSNPs << ",\n"
+		<< "\t\t\"noSNPsInThinnedFile\": " << stats.noSNPs << ",\n"
+		<< "\t\t\"noSNPsMissing\": " << noMissing << ",\n"
+		<< "\t\t\"unordered\": " << (foundUnorderedSNP ? "true" : "false") << ",\n"
+		<< "\t\t\"noGaps\": " << gapStats.noGaps << ",\n"
+		<< "\t\t\"meanGap\": "; RunReport::writeNumber(report, gapStats.mean);
+	report << ",\n\t\t\"stdevGap\": "; RunReport::writeNumber(report, gapStats.noGaps > 0 ? sqrt(gapStats.sumSquares/(double)gapStats.noGaps) : 0);
+
+	//as on the screen, the distance from the first to the last SNP of each chromosome, added up and shared between the SNPs less one
+	report << ",\n\t\t\"meanDistancePerSNP\": "; RunReport::writeNumber(report, stats.mean);
+	report << ",\n\t\t\"stdevDistancePerSNP\": "; RunReport::writeNumber(report, stats.stdev);
+	report << ",\n\t\t\"minGap\": "; RunReport::writeNumber(report, stats.minDis);
+	report << ",\n\t\t\"maxGap\": "; RunReport::writeNumber(report, stats.maxDis);
+	report << ",\n\t\t\"medianGap\": "; RunReport::writeNumber(report, stats.median);
+	report << ",\n\t\t\"percentile95Gap\": "; RunReport::writeNumber(report, stats.percentile95);
+
+	//only the bins with gaps in them
+	report << ",\n\t\t\"gapHistogram\": [";
+	bool firstBin = true;
+	for(unsigned int b = 0; b < gapStats.histogram.size(); ++b)
+	{
+		if(gapStats.histogram[b] == 0) continue;
+
+		report << (firstBin ? "\n" : ",\n") << "\t\t\t{\"from\": ";
+		if(b == 0) report << "null"; else RunReport::writeNumber(report, GapStats::getBinLowerLimit(b));
+		report << ", \"to\": ";
+		if(b + 1 == gapStats.histogram.size()) report << "null"; else RunReport::writeNumber(report, GapStats::getBinLowerLimit(b + 1));
+		report << ", \"count\": " << gapStats.histogram[b] << "}";
+		firstBin = false;
+	};
+	report << (firstBin ? "]" : "\n\t\t]") << "\n\t}\n}\n";
+
+	report.close();
+};
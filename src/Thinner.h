@@ -27,87 +27,241 @@
 #ifndef __MAPTHIN
 #define __MAPTHIN
 
-#include <list>
+#include <vector>
 #include <string>
-#include <map>
+#include <limits>
+#include <functional>
+#include <stdint.h>
 #include <iostream>
 #include <ostream>
 #include <fstream>
 
+#include "MapFileReader.h"
+#include "MapFileWriter.h"
+#include "MapFileIndex.h"
+#include "MapFileSnapshot.h"
+#include "SNPThinner.h"
+#include "ScoreIndex.h"
+#include "Gzip.h"
+
 using namespace std;
 
-//! Class to store data for one SNP
-struct SNP
+//! Part of a map file to thin, the SNPs of one chromosome, within a range of base pair positions if one is given.
+struct MapRegion
 {
-	double geneticDistance; // in cM
-	bool include; //include in thinned SNP file
+	string chromosome; //empty for all of the map file
+	bool hasRange;
+	double start, end; //inclusive
+
+	MapRegion() : chromosome(""), hasRange(false), start(0), end(0) {};
 
-	SNP(double & gd) : geneticDistance(gd), include(false) {};
+	~MapRegion() {};
 
-	~SNP() {};
+	bool isSet() const {return chromosome != "";};
+	bool contains(const MapLine & aLine) const;
+	bool parse(const string & regionString, string & error);
+	string str() const;
 };
 
-//! Class for thinning a map file.
-class MapThinner
+//! Returns whether the SNP of a line is in the region.
+inline bool MapRegion::contains(const MapLine & aLine) const
+{
+	if(aLine.chromosome != chromosome) return false;
+	if(!hasRange) return true;
+
+	double position = aLine.basePairPosition.toPosition();
+
+	return position >= start && position <= end;
+};
+
+//! How the SNPs are sorted on chromosome and position before thinning, if they are, so that unordered map files are thinned correctly.
+struct SortSettings
+{
+	bool sort;
+	bool keepOrder; //write the kept lines in the order of the map files rather than sorted
+	size_t memoryBudget; //in bytes, for sorting in memory, beyond which sorted runs are spilled to temporary files
+
+	SortSettings() : sort(false), keepOrder(false), memoryBudget((size_t)1 << 30) {};
+
+	~SortSettings() {};
+};
+
+//! The score file, if one is given, of scores such as the MAF or INFO of each SNP ID, used to prefer better SNPs near each marker.
+struct ScoreSettings
+{
+	string filename; //empty for no scores
+	double window; //in cM (or base pair position), 0 for half the step between markers
+
+	ScoreSettings() : filename(""), window(0) {};
+
+	~ScoreSettings() {};
+};
+
+//! One thinning of a sweep: SNPs per cM (t), total no. of SNPs to keep (s) or percentage of SNPs to keep (p), and the file written.
+struct SweepSetting
+{
+	char option;
+	double value;
+	string outputFileName;
+	double snpsPerCM; //used for the thinning
+	unsigned int noKept;
+
+	SweepSetting(const char & op, const double & val, const string & ofn) : option(op), value(val), outputFileName(ofn), snpsPerCM(0), noKept(0) {};
+
+	~SweepSetting() {};
+};
+
+//! One of the map files thinned together. When several map files are read at once, the SNPs of each are kept here until they
+//! are added to the thinner in the order of the map files.
+struct InputMapFile
 {
-private:
 	string filename;
+	MapFileReader readMap; //kept open so the lines can be written without reading the file again
+	size_t firstChromosome, noChromosomes; //of the chromosomes of the thinner, those read from this map file
+	size_t firstSNP; //index of the first SNP of this map file in the genetic distances of all SNPs
+	vector<size_t> fileSNPs; //number of each SNP in the map file counting from 0, if only a region is thinned
+	vector<size_t> linePositions; //of the line of each SNP, if the SNPs are sorted so the lines are written in another order
+	size_t noFileSNPs; //in all of the map file
+	size_t noBytesRead; //of the map file to find the SNPs, all of it unless the region was found with the index
+	string readError; //set if the map file cannot be read, as several may be read at once
+	bool snapshot; //the SNPs are read from a snapshot beside the map file, or one is written after reading the map file
+	bool readFromSnapshot;
+
+	bool buffered; //the SNPs read are kept in the chromosomes and positions below until added to the thinner
+	vector<Chromosome> chromosomes;
+	vector<double> positions;
+	vector<float> scores; //of the SNPs read, if there is a score file
+
+	InputMapFile(const string & fn) : filename(fn), readMap(), firstChromosome(0), noChromosomes(0), firstSNP(0), fileSNPs(), linePositions(), noFileSNPs(0), noBytesRead(0), readError(""),
+		snapshot(false), readFromSnapshot(false), buffered(false), chromosomes(), positions(), scores() {};
+
+	~InputMapFile() {};
+};
+
+//! Class for thinning map files, the SNPs are read from the map files and the lines of the SNPs kept are written to the thinned file.
+//! Several map files, such as one for each chromosome, are thinned as one, with the thinned lines written to one file or a file for each.
+class MapThinner : public SNPThinner
+{
+private:
+	vector<InputMapFile *> inputs; //in the order their SNPs are added
 	string outputFileName;
-	double snpsPerCM;
-	bool useBasePairPosition;
-	unsigned int noMissing;
-	unsigned int totalNoSNPs;
-	double totalCM;
+	bool splitOutput; //write a thinned file for each map file, named with the map file before the file extension
 	bool writeThinnedFile;
 	bool bim;
-	bool search;
-	bool foundUnorderedSNP;
+	bool vcf; //the SNPs are the records of a VCF file, thinned on the base pair position
 	bool nameOnly;
+	bool compressOutput; //the output files are written as BGZF
+	bool thinBed; //also write the .bed and .fam files for the thinned .bim file
+	bool writeMissingFile; //the SNPs with missing positions are only written once in a sweep
+	vector<SweepSetting> sweepSettings; //the thinnings done by a sweep, for the report
+	MapRegion region; //only the SNPs in the region are thinned, if it is set
+	SortSettings sortSettings;
+	ScoreSettings scoreSettings;
+	ScoreIndex scoreIndex; //the scores of the SNP IDs, if there is a score file
+	bool useSnapshots; //of the SNPs read from each map file, so that the map file is only parsed once
+	size_t noBytesRead; //of all of the map files to find the SNPs
 
-	list<SNP *> theSNPs;
-	map<string, list<double> > geneticDistancesInFinal; //chromosome, genetic distances, used to calc stats of final file
-
-	ifstream readMap;
-	ofstream writeMap;
+	MapFileWriter writeMap; //the lines kept are copied from the map file data
 	
-	ofstream writeMissing; //SNPs with missing genetic distance (or base pair position)
+	MapFileWriter writeMissing; //SNPs with missing genetic distance (or base pair position)
 	
 public:
 
-	MapThinner(string & fn, string & ofn, double & spc, bool & ubp, bool & no) :
-	  filename(fn), outputFileName(ofn), snpsPerCM(spc), useBasePairPosition(ubp), noMissing(0), totalNoSNPs(0), totalCM(0), writeThinnedFile(true), bim(false), search(false), foundUnorderedSNP(false), nameOnly(no)
+	MapThinner(vector<string> & fns, string & ofn, double & spc, bool & ubp, bool & no, unsigned int & nt, MapRegion & rg, bool & so, SortSettings & ss, ScoreSettings & sc, bool & sn)
+	  : SNPThinner(ubp, nt),
+	  inputs(), outputFileName(ofn), splitOutput(so), writeThinnedFile(true), bim(false), vcf(false), nameOnly(no), compressOutput(isCompressedFileName(ofn)), thinBed(false),
+	  writeMissingFile(true), sweepSettings(), region(rg), sortSettings(ss), scoreSettings(sc), scoreIndex(), useSnapshots(sn), noBytesRead(0)
 	  {
+		    snpsPerCM = spc;
+			setScoreWindow(scoreSettings.window);
+			for(vector<string>::const_iterator fn = fns.begin(); fn != fns.end(); ++fn) inputs.push_back(new InputMapFile(*fn));
 		    setBim();
-			setTotalNoSNPs();
+			readSNPs();
+	  };
+
+	//for one map file kept to thin many times, read with readMapFiles so that errors do not end the program
+	MapThinner(const string & fn, const bool & ubp, const unsigned int & nt, const MapRegion & rg) : SNPThinner(ubp, nt),
+	  inputs(1, new InputMapFile(fn)), outputFileName(""), splitOutput(false), writeThinnedFile(true), bim(false), vcf(false), nameOnly(false), compressOutput(false), thinBed(false),
+	  writeMissingFile(true), sweepSettings(), region(rg), sortSettings(), scoreSettings(), scoreIndex(), useSnapshots(false), noBytesRead(0)
+	  {
+			setBim();
 	  };
 
 	
 	~MapThinner()
 	{
-		for(list<SNP *>::iterator i = theSNPs.begin(); i != theSNPs.end(); ++i)
-		{
-			delete *i;
-		};
+		for(vector<InputMapFile *>::iterator i = inputs.begin(); i != inputs.end(); ++i) delete *i;
 	};
 
 	void thin();
-	void thinSNPs(string & chromosomeToThin);
-	void includeSNPsForFinal();
-	void outputMissing(string & chromosome, string & snpIdentifier, string & geneticDistance, string & basePairPosition, string & alleleName1, string & alleleName2);
+	void writeThinnedFiles();
+	void writeThinnedSNPs();
+	void writeInputSNPs(InputMapFile & input, const bool & copyHeaderLines);
+	void writeThinnedSNPsInParallel();
+	void writeSortedSNPs();
+	void getWrittenSNPs(vector<size_t> & thinnedSNPs, vector<size_t> & missingSNPs) const;
+	size_t getInputOfSNP(const size_t & snp) const;
+	void writeSNPLine(LineSink & writeMapFile, const size_t & snp);
+	void readSNPLine(InputMapFile & input, MapLine & aLine, const bool & copyHeaderLines);
+	void writeThinnedBed();
+	void setThinBed();
+	string getOutputFileName(const size_t & inputNo) const;
+	void openOutputFile(const size_t & inputNo);
+	void openMissingFile();
+	string getMissingFileName() const;
+	void outputMissing(const MapLine & aLine);
 	void displayFinalFileStats();
 	void displayMissingDataStats();
 	void displayWarningUnordered();
-	void setSNPsPerCMFromTotalSNPs(unsigned int & totalSNPsToKeep);
-	void setTotalNoSNPs();
+	void readSNPs();
+	string readScores();
+	string readMapFiles();
+	void readMapFile(InputMapFile & input, ThreadPool * decompressThreadPool);
+	void readIndexedSNPs(InputMapFile & input, const MapFileIndex & index);
+	void readSnapshotSNPs(InputMapFile & input, const MapFileSnapshot & snapshot);
+	void writeSnapshot(const InputMapFile & input) const;
+	void addLineSNP(InputMapFile & input, const MapLine & aLine, const size_t & linePosition);
+	void addBufferedSNPs(InputMapFile & input);
 	void setBim();
-	void readLineData(ifstream & readMapFile, string & chromosome, string & snpIdentifier, string & geneticDistance, string & basePairPosition, string & alleleName1, string & alleleName2);
-	void writeLineData(ofstream & writeMapFile, string & chromosome, string & snpIdentifier, string & geneticDistance, string & basePairPosition, string & alleleName1, string & alleleName2);
-	unsigned int getTotalNoThinnedSNPs();
+	void setOutput(const string & ofn, const bool & no) {outputFileName = ofn; nameOnly = no; compressOutput = isCompressedFileName(ofn);};
+	void setWriteMissingFile(const bool & wmf) {writeMissingFile = wmf;};
+	void clearRunReport() {runReport = RunReport();};
+	void writeLineData(LineSink & writeMapFile, const MapLine & aLine);
 	void thinToTargetNoSNPs(unsigned int & targetThinnedSNPs);
 	void thinToTargetPercentNoSNPs(double & percentToKeep);
-	unsigned int tryThinning(double & snpsPerCMToTry);
-	pair<double, double> getSNPsPerCMInterval(unsigned int & targetThinnedSNPs);
+	void sweep(const vector<SweepSetting> & settings);
+	void writeReport(const string & reportFileName);
 };
 
-#endif
+//! Adds the SNP of a line of a map file, starting a new block of SNPs for the next chromosome. The SNPs of each map file start a new block.
+inline void MapThinner::addLineSNP(InputMapFile & input, const MapLine & aLine, const size_t & linePosition)
+{
+	double position;
+	if(useBasePairPosition) position = aLine.basePairPosition.toPosition();
+	else position = aLine.geneticDistance.toDouble();
+
+	if(region.isSet()) input.fileSNPs.push_back(input.noFileSNPs);
+	if(sortSettings.sort || input.snapshot) input.linePositions.push_back(linePosition);
+
+	//SNPs not in the score file have no score
+	float score = noSNPScore;
+	if(scoreSettings.filename != "") scoreIndex.find(aLine.snpIdentifier, score);
 
+	if(input.buffered)
+	{
+		if(input.chromosomes.empty() || aLine.chromosome != input.chromosomes.back().name) input.chromosomes.push_back(Chromosome(aLine.chromosome.str(), input.positions.size(), linePosition));
+
+		input.chromosomes.back().noSNPs++;
+		input.positions.push_back(position);
+		if(scoreSettings.filename != "") input.scores.push_back(score);
+	}
+	else
+	{
+		if(theChromosomes.size() == input.firstChromosome || aLine.chromosome != theChromosomes.back().name) startChromosome(aLine.chromosome.str(), linePosition);
+
+		addSNP(position);
+		if(scoreSettings.filename != "") addSNPScore(score);
+	};
+};
+
+#endif
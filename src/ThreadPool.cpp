@@ -0,0 +1,109 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+//! Starts the worker threads, no threads are started for a pool of one thread.
+ThreadPool::ThreadPool(const unsigned int & noThreads) : workers(), task(0), noTasks(0), nextTask(0), noWorking(0), jobNumber(0), stopping(false)
+{
+	for(unsigned int t = 1; t < noThreads; ++t) workers.push_back(thread(&ThreadPool::work, this));
+};
+
+//! Stops and joins the worker threads.
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobStarted.notify_all();
+
+	for(vector<thread>::iterator w = workers.begin(); w != workers.end(); ++w) w->join();
+};
+
+//! Runs task(0), ..., task(noTasksToRun - 1) and returns once all of them are done.
+void ThreadPool::run(const size_t & noTasksToRun, const function<void(size_t)> & taskToRun)
+{
+	if(noTasksToRun == 0) return;
+
+	if(workers.empty() || noTasksToRun == 1)
+	{
+		for(size_t t = 0; t < noTasksToRun; ++t) taskToRun(t);
+		return;
+	};
+
+	lock_guard<mutex> runLock(runMutex);
+
+	{
+		lock_guard<mutex> lock(jobMutex);
+		task = &taskToRun;
+		noTasks = noTasksToRun;
+		nextTask = 0;
+		noWorking = workers.size();
+		++jobNumber;
+	}
+	jobStarted.notify_all();
+
+	runTasks();
+
+	unique_lock<mutex> lock(jobMutex);
+	while(noWorking != 0) jobFinished.wait(lock);
+	task = 0;
+};
+
+//! Takes tasks in order until there are none left.
+void ThreadPool::runTasks()
+{
+	size_t t;
+
+	while((t = nextTask++) < noTasks) (*task)(t);
+};
+
+//! Waits for sets of tasks to run until the pool is stopped.
+void ThreadPool::work()
+{
+	unsigned long lastJobNumber = 0;
+
+	while(true)
+	{
+		{
+			unique_lock<mutex> lock(jobMutex);
+			while(!stopping && jobNumber == lastJobNumber) jobStarted.wait(lock);
+			if(stopping) return;
+			lastJobNumber = jobNumber;
+		}
+
+		runTasks();
+
+		{
+			lock_guard<mutex> lock(jobMutex);
+			--noWorking;
+			if(noWorking == 0) jobFinished.notify_one();
+		}
+	};
+};
@@ -0,0 +1,68 @@
+/************************************************************************
+ * MapThin version 1.11
+ * Copyright 2011-2014,
+ * Richard Howey
+ * Institute of Genetic Medicine, Newcastle University
+ *
+ * richard.howey@ncl.ac.uk
+ * http://www.staff.ncl.ac.uk/richard.howey/
+ *
+ * This file is part of MapThin, a program to thin map files.
+ *
+ * MapThin is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MapThin is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MapThin.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+
+
+#ifndef __THREADPOOL
+#define __THREADPOOL
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+//! Class for running numbered tasks on a fixed set of threads, the calling thread also runs tasks.
+class ThreadPool
+{
+private:
+	vector<thread> workers;
+	mutex runMutex; //only one set of tasks is run at a time
+	mutex jobMutex;
+	condition_variable jobStarted;
+	condition_variable jobFinished;
+	const function<void(size_t)> * task;
+	size_t noTasks;
+	atomic<size_t> nextTask;
+	unsigned int noWorking; //workers yet to finish the current set of tasks
+	unsigned long jobNumber;
+	bool stopping;
+
+	void work();
+	void runTasks();
+
+public:
+
+	ThreadPool(const unsigned int & noThreads);
+	~ThreadPool();
+
+	unsigned int getNoThreads() const {return workers.size() + 1;};
+	void run(const size_t & noTasksToRun, const function<void(size_t)> & taskToRun);
+};
+
+#endif
@@ -26,14 +26,18 @@
 
 #include <iostream>
 #include <ostream>
+#include <fstream>
 #include <set>
 #include <string>
+#include <vector>
 
 
 using namespace std; // initiates the "std" or "standard" namespace
  
 #include "main.h"
 #include "Thinner.h"
+#include "MapThinServer.h"
+#include "Gzip.h"
 
 bool outputToScreen = true; 
 
@@ -51,7 +55,9 @@ void usage()
 {
 		header();
 	 	
-		cout << "Usage:\n\t ./mapthin [options] data-in.map data-out.map\n\n"
+		cout << "Usage:\n\t ./mapthin [options] data-in.map [more-data-in.map ...] data-out.map\n\n"
+		<< "The input may also be a .bim or .vcf file, which may be gzipped. VCF files are thinned on the base pair position.\n"
+		<< "Several map files of the same type are thinned as one, e.g. one for each chromosome, and written to one file.\n\n"
 
 		<< "Options:\n"
 		<< "  -t x          -- SNPs per cM, x\n"
@@ -59,26 +65,112 @@ void usage()
 		<< "  -p z          -- Percentage of SNPs to keep, z\n"	
 		<< "  -b [w]        -- Use base pair position [with w SNPs per 10^6 bpp in file]\n"	
 		<< "  -n            -- Output the name of the SNPs only\n"	
+		<< "  -threads n    -- Number of threads to use, n\n"
+		<< "  -report f     -- Write a JSON report of the run to file f\n"
+		<< "  -bed          -- Also thin the .bed and .fam files of a .bim file\n"
+		<< "  -sweep l      -- Thin once for each setting in list l, e.g. t2,t5,s10000,p50\n"
+		<< "  -chr c        -- Only thin the SNPs on chromosome c\n"
+		<< "  -region r     -- Only thin the SNPs in region r, chromosome:start-end in base pair position\n"
+		<< "  -list f       -- Also thin the map files listed in file f, one on each line\n"
+		<< "  -split        -- Write a thinned file for each map file, e.g. data-out.chr1.map for chr1.map\n"
+		<< "  -sort         -- Sort the SNPs on chromosome and position before thinning, writing them sorted\n"
+		<< "  -keeporder    -- Sort the SNPs before thinning, writing them in the order of the map files\n"
+		<< "  -sortmem m    -- Sort in m MB of memory, using temporary files if more is needed\n"
+		<< "  -score f      -- Prefer SNPs with higher scores near each marker, given by SNP ID and score in file f\n"
+		<< "  -scorewin w   -- Choose on the scores of SNPs within w of each marker, default half the gap between markers\n"
+		<< "  -snapshot     -- Keep the SNPs read in a file beside each map file, e.g. data.map.mts, to read faster next time\n"
+		<< "  -serve s      -- Serve thinning requests on local socket s, keeping the map files read\n"
+		<< "  -cache n      -- Number of map files kept by the server, n\n"
+		<< "  -client s ... -- Send the request that follows, or each line given, to the server on socket s\n"
 		<< "  -so           -- suppress output to screen\n\n"
 		<< "Default Options:\n"
 		<< "  -t 2.4\n\n";
 
 };
 
+//! Splits a comma separated list of sweep settings, each of t, s or p followed by the number for that option
+vector<SweepSetting> getSweepSettings(const string & sweepList, const string & outputFileName)
+{
+	vector<SweepSetting> settings;
+	size_t start = 0, end;
+	string setting;
+	double value;
+
+	while(start <= sweepList.length())
+	{
+		end = sweepList.find(',', start);
+		if(end == string::npos) end = sweepList.length();
+
+		setting = sweepList.substr(start, end - start);
+		start = end + 1;
+
+		value = 0;
+		if(setting.length() > 1) value = atof(setting.c_str() + 1);
+
+		if(setting.length() < 2 || (setting[0] != 't' && setting[0] != 's' && setting[0] != 'p') || !(value > 0) || (setting[0] == 'p' && !(value < 100)))
+		{
+			cerr << "Invalid sweep setting: " << setting << "!\n";
+			exit(1);
+		};
+
+		settings.push_back(SweepSetting(setting[0], value, getTaggedFileName(outputFileName, setting)));
+	};
+
+	return settings;
+};
+
+//! Reads a list of map file names, one on each line, blank lines are ignored
+void readFileNameList(const string & listFileName, vector<string> & filenames)
+{
+	ifstream readList(listFileName.c_str());
+
+	if(!readList.is_open())
+	{
+		cerr << "Cannot read list of map files: " << listFileName << "!\n";
+		exit(1);
+	};
+
+	string line;
+	size_t start, end;
+
+	while(getline(readList, line))
+	{
+		start = line.find_first_not_of(" \t\r");
+		if(start == string::npos) continue;
+
+		end = line.find_last_not_of(" \t\r");
+		filenames.push_back(line.substr(start, end - start + 1));
+	};
+};
+
 //! The start of the program
 int main(int argc, char * argv[])
 {
 	int argcount = 1;
 	string option;
-	string filename = "";
+	vector<string> filenames;
+	string listFileName = "";
+	bool splitOutput = false;
+	string servePath = "";
+	unsigned int cacheSize = 4;
 	string outputFileName = "";
 	double snpsPerCM = 2.4;
+	bool snpsPerCMGiven = false;
 	unsigned int totalSNPsToKeep = 0;
 	double percentToKeep = 0;
 	unsigned int format = 1; // 1 = PLINK, 2 = Merlin
 	bool useBasePairPosition = false; //if this is set to true then read snps per cM as base pair position thro'out
 	outputToScreen = true;
 	bool nameOnly = false;
+	unsigned int noThreads = 1;
+	string reportFileName = "";
+	bool thinBed = false;
+	string sweepList = "";
+	MapRegion region;
+	string regionError;
+	SortSettings sortSettings;
+	ScoreSettings scoreSettings;
+	bool useSnapshots = false;
 
 	//set given options
 	while(argcount < argc && argv[argcount][0] == '-')
@@ -96,8 +188,9 @@ int main(int argc, char * argv[])
 			//check if a number for the SNPs per Mbase was specified, if not process option as before
 			if(option.substr(0,1) != "-")
 			{
+				 option = removeCompressedExtension(option);
 				 if(!(option.length() >= 4 && (option.substr(option.length()-4, 4) == ".map" || option.substr(option.length()-4, 4) == ".bim" 
-					 || option.substr(option.length()-4, 4) == ".MAP" || option.substr(option.length()-4, 4) == ".BIM")))
+					 || option.substr(option.length()-4, 4) == ".MAP" || option.substr(option.length()-4, 4) == ".BIM" || isVCFFileName(option))))
 				 {
 					snpsPerCM = atof(argv[argcount]);
 					option = "--";
@@ -111,7 +204,8 @@ int main(int argc, char * argv[])
 		if(option ==  "-t")
 		{			
 			argcount++; if(argcount >= argc) break;
-			snpsPerCM = atof(argv[argcount]);			
+			snpsPerCM = atof(argv[argcount]);
+			snpsPerCMGiven = true;
 		}
 		else if(option ==  "-s")
 		{			
@@ -123,6 +217,102 @@ int main(int argc, char * argv[])
 			argcount++; if(argcount >= argc) break;
 			percentToKeep = atof(argv[argcount]);			
 		}		
+		else if(option ==  "-threads")
+		{			
+			argcount++; if(argcount >= argc) break;
+			noThreads = atoi(argv[argcount]);
+			if(noThreads < 1) noThreads = 1;
+		}
+		else if(option ==  "-report")
+		{			
+			argcount++; if(argcount >= argc) break;
+			reportFileName = argv[argcount];
+		}
+		else if(option ==  "-sweep")
+		{			
+			argcount++; if(argcount >= argc) break;
+			sweepList = argv[argcount];
+		}
+		else if(option ==  "-chr")
+		{			
+			argcount++; if(argcount >= argc) break;
+			region = MapRegion();
+			region.chromosome = argv[argcount];
+		}
+		else if(option ==  "-region")
+		{			
+			argcount++; if(argcount >= argc) break;
+			region = MapRegion();
+			if(!region.parse(argv[argcount], regionError))
+			{
+				cerr << regionError << "!\n";
+				exit(1);
+			};
+		}
+		else if(option ==  "-list")
+		{			
+			argcount++; if(argcount >= argc) break;
+			listFileName = argv[argcount];
+		}
+		else if(option ==  "-sortmem")
+		{			
+			argcount++; if(argcount >= argc) break;
+			double sortMB = atof(argv[argcount]);
+			if(sortMB < 1) sortMB = 1;
+			sortSettings.memoryBudget = (size_t)(sortMB*1048576);
+		}
+		else if(option ==  "-score")
+		{			
+			argcount++; if(argcount >= argc) break;
+			scoreSettings.filename = argv[argcount];
+		}
+		else if(option ==  "-scorewin")
+		{			
+			argcount++; if(argcount >= argc) break;
+			scoreSettings.window = atof(argv[argcount]);
+			if(!(scoreSettings.window >= 0))
+			{
+				cerr << "The score window must not be negative!\n";
+				exit(1);
+			};
+		}
+		else if(option ==  "-serve")
+		{			
+			argcount++; if(argcount >= argc) break;
+			servePath = argv[argcount];
+		}
+		else if(option ==  "-cache")
+		{			
+			argcount++; if(argcount >= argc) break;
+			cacheSize = atoi(argv[argcount]);
+			if(cacheSize < 1) cacheSize = 1;
+		}
+		else if(option ==  "-client")
+		{			
+			argcount++; if(argcount >= argc) break;
+			string socketPath = argv[argcount++];
+			vector<string> requests;
+			string request = "";
+
+			//the rest of the command line is the request, otherwise requests are read from standard input, one on each line
+			for(; argcount < argc; ++argcount) request += (request == "" ? "" : " ") + string(argv[argcount]);
+
+			if(request != "") requests.push_back(request);
+			else
+			{
+				while(getline(cin, request))
+				{
+					if(request.find_first_not_of(" \t\r") != string::npos) requests.push_back(request);
+				};
+			};
+
+			exit(runThinClient(socketPath, requests));
+		}
+		else if(option == "-split") splitOutput = true;
+		else if(option == "-sort") sortSettings.sort = true;
+		else if(option == "-keeporder") sortSettings.sort = sortSettings.keepOrder = true;
+		else if(option == "-snapshot") useSnapshots = true;
+		else if(option == "-bed") thinBed = true;
 		else if(option == "-so") outputToScreen = false;
 		else if(option == "-n") nameOnly = true;
 		else if(option == "--") {}
@@ -136,45 +326,117 @@ int main(int argc, char * argv[])
 		argcount++;
 	};
 
-	if(argcount < argc) filename = argv[argcount++];	
+	//the map files and thinned files are given by each request to the server
+	if(servePath != "")
+	{
+		header();
+		if(outputToScreen) cout << "Serving thinning requests on socket: " << servePath << "\n"
+			<< "Number of map files kept: " << cacheSize << "\n"
+			<< "Number of threads for each map file: " << noThreads << "\n\n";
+
+		//each request and its answer are written to the screen instead of the output of each thinning
+		MapThinServer server(servePath, noThreads, cacheSize, outputToScreen);
+		outputToScreen = false;
+
+		exit(server.run() ? 0 : 1);
+	};
+
+	//the last file name is the thinned file, those before are the map files to thin
+	if(listFileName != "") readFileNameList(listFileName, filenames);
+	while(argcount + 1 < argc) filenames.push_back(argv[argcount++]);
 	if(argcount < argc) outputFileName = argv[argcount];	
 
-	if(filename == "" || outputFileName == "")
+	if(filenames.empty() || outputFileName == "")
 	{
 		usage();
 		exit(0);
 	};	
 
+	//VCF files only have base pair positions
+	if(isVCFFileName(filenames[0]) && !useBasePairPosition)
+	{
+		useBasePairPosition = true;
+		if(!snpsPerCMGiven) snpsPerCM = 6.7;
+	};
+
 	
 	//output options to screen
 	if(outputToScreen)
 	{
 		header();
 		cout << "Parameters:\n";
-		cout << "Input file: "<<filename <<"\n";
+		if(filenames.size() == 1) cout << "Input file: "<<filenames[0] <<"\n";
+		else
+		{
+			cout << "Input files:";
+			for(vector<string>::const_iterator fn = filenames.begin(); fn != filenames.end(); ++fn) cout << " " << *fn;
+			cout << "\n";
+		};
 		cout << "Output file: "<<outputFileName;
+		if(splitOutput) cout << " - one for each input file";
 		if(nameOnly) cout << " - SNP names only\n";
 		else cout << "\n";
 		
-		if(totalSNPsToKeep > 0) cout << "Total SNPs to keep: "<< totalSNPsToKeep <<"\n";
+		if(sweepList != "") cout << "Sweep of settings: "<< sweepList <<"\n";
+		else if(totalSNPsToKeep > 0) cout << "Total SNPs to keep: "<< totalSNPsToKeep <<"\n";
 		else if(percentToKeep > 0) cout << "Percentage of SNPs to keep: "<< percentToKeep <<"\n";
 		else if(!useBasePairPosition) cout << "SNPs per cM: "<< snpsPerCM <<"\n";
 		else cout << "SNPs per 10^6 base pair position (in file): "<< snpsPerCM <<"\n";
-		if(useBasePairPosition && (totalSNPsToKeep > 0 || percentToKeep > 0)) cout << "Using base pair position\n";
+		if(useBasePairPosition && (totalSNPsToKeep > 0 || percentToKeep > 0 || sweepList != "")) cout << "Using base pair position\n";
+		if(region.isSet()) cout << "Region: "<< region.str() <<"\n";
+		if(sortSettings.keepOrder) cout << "Sorting the SNPs, written in the original order\n";
+		else if(sortSettings.sort) cout << "Sorting the SNPs\n";
+		if(scoreSettings.filename != "")
+		{
+			cout << "Score file: "<< scoreSettings.filename;
+			if(scoreSettings.window > 0) cout << " - window " << scoreSettings.window << "\n";
+			else cout << "\n";
+		};
+		if(useSnapshots) cout << "Using snapshots of the map files\n";
+		if(noThreads > 1) cout << "Number of threads: "<< noThreads <<"\n";
 		cout << "\n";
 	};
 
 	//check parameters
+	if(!gzipSupported && isCompressedFileName(outputFileName))
+	{
+		cerr << "This version of MapThin was compiled without zlib and cannot write compressed files!\n";
+		exit(1);
+	};
+
 	if(percentToKeep != 0 && !(percentToKeep < 100 && percentToKeep > 0))
 	{
 		cerr << "The percentage of SNPs to keep must be between 0 and 100!\n";
 		exit(1);
 	};
 
+	//the thinned files are named after the map files, so the names must differ
+	if(splitOutput)
+	{
+		set<string> stems;
+		for(vector<string>::const_iterator fn = filenames.begin(); fn != filenames.end(); ++fn)
+		{
+			if(!stems.insert(getFileNameStem(*fn)).second)
+			{
+				cerr << "Cannot write a thinned file for each map file, more than one is named " << getFileNameStem(*fn) << "!\n";
+				exit(1);
+			};
+		};
+	};
+
+	vector<SweepSetting> sweepSettings;
+	if(sweepList != "") sweepSettings = getSweepSettings(sweepList, outputFileName);
+
 	//create mapthinner and then thin
-	MapThinner mapThinner(filename, outputFileName, snpsPerCM, useBasePairPosition, nameOnly);
+	MapThinner mapThinner(filenames, outputFileName, snpsPerCM, useBasePairPosition, nameOnly, noThreads, region, splitOutput, sortSettings, scoreSettings, useSnapshots);
+
+	if(thinBed) mapThinner.setThinBed();
 
-	if(totalSNPsToKeep > 0)
+	if(!sweepSettings.empty())
+	{
+		mapThinner.sweep(sweepSettings);
+	}
+	else if(totalSNPsToKeep > 0)
 	{		
 		mapThinner.thinToTargetNoSNPs(totalSNPsToKeep);
 	}
@@ -185,5 +447,7 @@ int main(int argc, char * argv[])
 	else
 		mapThinner.thin();
 
+	if(reportFileName != "") mapThinner.writeReport(reportFileName);
+
 };
 